@@ -1,2 +1,13 @@
 COMPONENT_SRCDIRS:=.
 COMPONENT_ADD_INCLUDEDIRS:=.
+
+# Conversion lookup tables for the low resolution modes (see htu21d_lut.h)
+#CFLAGS += -DHTU21_LUT_T_12B_RH_8B
+#CFLAGS += -DHTU21_LUT_T_13B_RH_10B
+#CFLAGS += -DHTU21_LUT_T_11B_RH_11B
+
+# Numeric precision policy (see htu21d_numeric.h)
+#CFLAGS += -DHTU21_NUMERIC_POLICY=HTU21_NUMERIC_DOUBLE
+
+# Header-only static inline conversions, CRC check and dew point (see htu21d_compute.h)
+#CFLAGS += -DHTU21_INLINE_COMPUTE
@@ -11,6 +11,14 @@
  */
 
 #include "htu21d.h"
+#include "htu21d_governor.h"
+#include "htu21d_thermal.h"
+#include "htu21d_lut.h"
+#include "htu21d_metrics.h"
+#include "htu21d_mux.h"
+#include "htu21d_family.h"
+#include "htu21d_calibration.h"
+#include "esp_timer.h"
 
 /**
  * The header "i2c.h" has to be implemented for your own platform to // brad -> changed to esp32_i2c.h
@@ -48,7 +56,7 @@ extern "C" {
 #endif
 
 // HTU21 device address
-#define HTU21_ADDR                                            0x40 //0b1000000
+#define HTU21_ADDR                                            HTU21_DEFAULT_ADDRESS //0b1000000
 
 // HTU21 device commands
 #define HTU21_RESET_COMMAND                                    0xFE
@@ -63,30 +71,6 @@ extern "C" {
 
 #define RESET_TIME                                            15            // ms value
 
-// Processing constants
-#define HTU21_TEMPERATURE_COEFFICIENT                        (float)(-0.15)
-#define HTU21_CONSTANT_A                                    (float)(8.1332)
-#define HTU21_CONSTANT_B                                    (float)(1762.39)
-#define HTU21_CONSTANT_C                                    (float)(235.66)
-
-// Coefficients for temperature computation
-#define TEMPERATURE_COEFF_MUL                                (175.72)
-#define TEMPERATURE_COEFF_ADD                                (-46.85)
-
-// Coefficients for relative humidity computation
-#define HUMIDITY_COEFF_MUL                                    (125)
-#define HUMIDITY_COEFF_ADD                                    (-6)
-
-// Conversion timings
-#define HTU21_TEMPERATURE_CONVERSION_TIME_T_14b_RH_12b        50000
-#define HTU21_TEMPERATURE_CONVERSION_TIME_T_13b_RH_10b        25000
-#define HTU21_TEMPERATURE_CONVERSION_TIME_T_12b_RH_8b        13000
-#define HTU21_TEMPERATURE_CONVERSION_TIME_T_11b_RH_11b        7000
-#define HTU21_HUMIDITY_CONVERSION_TIME_T_14b_RH_12b            16000
-#define HTU21_HUMIDITY_CONVERSION_TIME_T_13b_RH_10b            5000
-#define HTU21_HUMIDITY_CONVERSION_TIME_T_12b_RH_8b            3000
-#define HTU21_HUMIDITY_CONVERSION_TIME_T_11b_RH_11b            8000
-
 // HTU21 User Register masks and bit position
 #define HTU21_USER_REG_RESOLUTION_MASK                        0x81
 #define HTU21_USER_REG_END_OF_BATTERY_MASK                    0x40
@@ -111,21 +95,613 @@ extern "C" {
 #define HTU21_USER_REG_ONCHIP_HEATER_ENABLE                    0x04
 #define HTU21_USER_REG_OTP_RELOAD_DISABLE                    0x02
 
-uint32_t htu21_temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_14b_RH_12b;
-uint32_t htu21_humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_14b_RH_12b;
-enum htu21_i2c_master_mode i2c_master_mode;
+// Device configuration word
+#define HTU21_CONFIG_RESOLUTION_MASK                        0x03    // enum htu21_resolution
+#define HTU21_CONFIG_HOLD_MASTER                            0x04    // htu21_i2c_hold
+
+// Clock-stretch timeout in no hold master mode, where the device does not hold the bus (us)
+#ifndef HTU21_STRETCH_TIMEOUT_US
+#define HTU21_STRETCH_TIMEOUT_US                            1000
+#endif
+
+// Devices served together by htu21_fleet_init, bounds its buffers on the stack
+#ifndef HTU21_FLEET_CHUNK
+#define HTU21_FLEET_CHUNK                                    16
+#endif
+
+// Devices measured together by htu21_dev_run_measurements, bounds its buffers on the stack
+#ifndef HTU21_MEASUREMENT_CHUNK
+#define HTU21_MEASUREMENT_CHUNK                                16
+#endif
+
+// Devices per batch, each transfer possibly preceded by a mux select
+#define HTU21_BATCH_DEVICES                                    (HTU21_BUS_BATCH_MAX_TRANSFERS / 2)
+
+// Transfer budget on top of clock stretching : 8 bytes at 100 kHz with margin (us)
+#ifndef HTU21_TRANSFER_TIMEOUT_US
+#define HTU21_TRANSFER_TIMEOUT_US                            2000
+#endif
+
+// User register values, indexed by enum htu21_resolution
+static const uint8_t htu21_user_reg_resolution[] = {
+    [htu21_resolution_t_14b_rh_12b] = HTU21_USER_REG_RESOLUTION_T_14b_RH_12b,
+    [htu21_resolution_t_12b_rh_8b]  = HTU21_USER_REG_RESOLUTION_T_12b_RH_8b,
+    [htu21_resolution_t_13b_rh_10b] = HTU21_USER_REG_RESOLUTION_T_13b_RH_10b,
+    [htu21_resolution_t_11b_rh_11b] = HTU21_USER_REG_RESOLUTION_T_11b_RH_11b,
+};
+
+// Significant bits of the ADC codes in each resolution : the lookup tables
+// and the run-time conversions both ignore the others, status bits included
+static const uint16_t htu21_temperature_adc_mask[] = {
+    [htu21_resolution_t_14b_rh_12b] = 0xFFFC,
+    [htu21_resolution_t_12b_rh_8b]  = 0xFFF0,
+    [htu21_resolution_t_13b_rh_10b] = 0xFFF8,
+    [htu21_resolution_t_11b_rh_11b] = 0xFFE0,
+};
+static const uint16_t htu21_humidity_adc_mask[] = {
+    [htu21_resolution_t_14b_rh_12b] = 0xFFF0,
+    [htu21_resolution_t_12b_rh_8b]  = 0xFF00,
+    [htu21_resolution_t_13b_rh_10b] = 0xFFC0,
+    [htu21_resolution_t_11b_rh_11b] = 0xFFE0,
+};
+
+// Default device, used by the functions without device argument
+static struct htu21_bus htu21_default_bus = {
+    .ops = &htu21_bus_esp32_ops,
+};
+static struct htu21_device htu21_default_device = {
+    .bus         = &htu21_default_bus,
+    .address     = HTU21_ADDR,
+    .config      = htu21_resolution_t_14b_rh_12b,
+    .reservation = -1,
+    .family      = &htu21_family_htu21d,
+};
 
 // Static functions
 //static enum htu21_status htu21_write_command(uint8_t);
 //static enum htu21_status htu21_write_command_no_stop(uint8_t);
-static enum htu21_status htu21_read_user_register(uint8_t *);
-static enum htu21_status htu21_write_user_register(uint8_t );
-static enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *);
-static enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *);
-static enum htu21_status htu21_crc_check( uint16_t, uint8_t);
+static enum htu21_status htu21_read_user_register(struct htu21_device *, uint8_t *);
+static enum htu21_status htu21_write_user_register(struct htu21_device *, uint8_t );
+static enum htu21_status htu21_temperature_conversion_and_read_adc(struct htu21_device *, uint32_t, uint16_t *);
+static enum htu21_status htu21_humidity_conversion_and_read_adc(struct htu21_device *, uint32_t, uint16_t *);
+static enum htu21_status htu21_previous_temperature_read_adc(struct htu21_device *, const struct htu21_family *,
+                                                             uint16_t *);
 
 static const char *TAG = "htu21d";
 
+static inline uint32_t htu21_config_load(const struct htu21_device *dev)
+{
+    return __atomic_load_n(&dev->config, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief Replaces the masked bits of the configuration word in one atomic step.
+ */
+static void htu21_config_update(struct htu21_device *dev, uint32_t mask, uint32_t value)
+{
+    uint32_t config = __atomic_load_n(&dev->config, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&dev->config, &config, (config & ~mask) | (value & mask), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        ;
+}
+
+static inline enum htu21_resolution htu21_config_resolution(uint32_t config)
+{
+    return (enum htu21_resolution) (config & HTU21_CONFIG_RESOLUTION_MASK);
+}
+
+static inline const struct htu21_family *htu21_dev_family(const struct htu21_device *dev)
+{
+    return __atomic_load_n(&dev->family, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief Converts a temperature ADC value of the device, bus lock held :
+ *        with the calibrated coefficients, or the lookup table or datasheet
+ *        conversion.
+ */
+static inline htu21_real_t htu21_dev_convert_temperature(const struct htu21_device *dev,
+                                                         enum htu21_resolution resolution, uint16_t adc)
+{
+    htu21_real_t value;
+
+    adc &= htu21_temperature_adc_mask[resolution];
+    if (dev->calibrated) {
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+        return (htu21_real_t) (((int64_t) adc * dev->conversion.temperature_mul + 0x8000) >> 16)
+               + dev->conversion.temperature_add;
+#else
+        return (htu21_real_t) adc * dev->conversion.temperature_mul + dev->conversion.temperature_add;
+#endif
+    }
+    if (!htu21_lut_temperature(resolution, adc, &value))
+        value = htu21_convert_temperature(adc);
+    return value;
+}
+
+/**
+ * \brief Converts a relative humidity ADC value of the device, bus lock held.
+ */
+static inline htu21_real_t htu21_dev_convert_humidity(const struct htu21_device *dev,
+                                                      enum htu21_resolution resolution, uint16_t adc)
+{
+    htu21_real_t value;
+
+    adc &= htu21_humidity_adc_mask[resolution];
+    if (dev->calibrated) {
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+        return (htu21_real_t) (((int64_t) adc * dev->conversion.humidity_mul + 0x8000) >> 16)
+               + dev->conversion.humidity_add;
+#else
+        return (htu21_real_t) adc * dev->conversion.humidity_mul + dev->conversion.humidity_add;
+#endif
+    }
+    if (!htu21_lut_humidity(resolution, adc, &value))
+        value = htu21_convert_humidity(adc);
+    return value;
+}
+
+/**
+ * \brief Blocks the calling task for at least the given time, rounded up to
+ *        whole ticks plus one. Returns at once for 0.
+ *
+ * \param[in] uint32_t : Time (us)
+ */
+void htu21_wait_us(uint32_t us)
+{
+    // vTaskDelay(n) counts from partway through the current tick and can
+    // end up to one tick early, so round up and add a tick to make sure the
+    // wait never ends before the requested time
+    if (us != 0)
+        vTaskDelay(((us + 999) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS
+                   + 1);
+}
+
+/**
+ * \brief Takes the bus of the device once the device is not measuring for
+ *        another task. Holds the bus lock on return.
+ */
+static void htu21_dev_acquire(struct htu21_device *dev)
+{
+    htu21_bus_lock(dev->bus);
+    while (dev->measuring) {
+        int64_t wait = dev->conversion_done_us - esp_timer_get_time();
+
+        htu21_bus_unlock(dev->bus);
+        htu21_wait_us((wait > 0) ? (uint32_t) wait : 1);
+        htu21_bus_lock(dev->bus);
+    }
+}
+
+static inline void htu21_dev_release(struct htu21_device *dev)
+{
+    htu21_bus_unlock(dev->bus);
+}
+
+/**
+ * \brief Returns the clock-stretch timeout of a configuration : in hold master
+ *        mode the device may hold SCL for the slowest conversion of its
+ *        family at the resolution.
+ */
+static uint32_t htu21_stretch_timeout(const struct htu21_device *dev, uint32_t config)
+{
+    const struct htu21_family *family = htu21_dev_family(dev);
+    enum htu21_resolution resolution = htu21_config_resolution(config);
+    uint32_t timeout = HTU21_STRETCH_TIMEOUT_US;
+
+    if (config & HTU21_CONFIG_HOLD_MASTER) {
+        if (family->temperature_conversion_time[resolution] > timeout)
+            timeout = family->temperature_conversion_time[resolution];
+        if (family->humidity_conversion_time[resolution] > timeout)
+            timeout = family->humidity_conversion_time[resolution];
+    }
+
+    return timeout;
+}
+
+/**
+ * \brief Returns the timeout of one transport operation in a configuration.
+ */
+static inline uint32_t htu21_transfer_timeout(const struct htu21_device *dev, uint32_t config)
+{
+    return HTU21_TRANSFER_TIMEOUT_US + htu21_stretch_timeout(dev, config);
+}
+
+/**
+ * \brief Applies the speed profile of the device to its bus, bus lock held.
+ *        Devices without profile leave the bus as it is. A clock-stretch
+ *        timeout above the limit of the transport falls back to the one of
+ *        no hold master mode.
+ *
+ * \return esp_err_t - ESP_ERR_INVALID_ARG when the hold master mode timeout
+ *         was refused.
+ */
+static esp_err_t htu21_dev_apply_speed(struct htu21_device *dev)
+{
+    uint32_t scl_hz = __atomic_load_n(&dev->scl_hz, __ATOMIC_RELAXED);
+    esp_err_t err;
+
+    if (scl_hz == 0)
+        return ESP_OK;
+
+    err = htu21_bus_set_speed(dev->bus, scl_hz, htu21_stretch_timeout(dev, htu21_config_load(dev)));
+    if (err == ESP_ERR_INVALID_ARG)
+        htu21_bus_set_speed(dev->bus, scl_hz, HTU21_STRETCH_TIMEOUT_US);
+
+    return err;
+}
+
+/**
+ * \brief Returns the configuration a measurement runs with, bus lock held. In
+ *        hold master mode the bus has to stretch the clock for the whole
+ *        conversion : when the transport refuses that timeout, the
+ *        measurement runs in no hold master mode.
+ */
+static uint32_t htu21_dev_measurement_config(struct htu21_device *dev)
+{
+    uint32_t config = htu21_config_load(dev);
+
+    if ((config & HTU21_CONFIG_HOLD_MASTER) && htu21_dev_apply_speed(dev) == ESP_ERR_INVALID_ARG)
+        config &= ~HTU21_CONFIG_HOLD_MASTER;
+
+    return config;
+}
+
+/**
+ * \brief Counts a transfer in the metrics of the device. Bytes include the
+ *        address byte, and are only counted when the transfer succeeded.
+ */
+static void htu21_dev_account(struct htu21_device *dev, esp_err_t err, uint32_t bytes, int64_t elapsed_us)
+{
+    struct htu21_metrics *metrics = __atomic_load_n(&dev->metrics, __ATOMIC_ACQUIRE);
+
+    if (metrics == NULL)
+        return;
+    if (err == ESP_OK)
+        metrics->transfer_bytes += bytes;
+    else
+        metrics->transfer_errors++;
+    metrics->transfer_time_us += (elapsed_us > 0) ? (uint64_t) elapsed_us : 0;
+}
+
+/**
+ * \brief Frees the bus after a transfer with the device timed out, bus lock
+ *        held, and counts the recovery in the metrics of the device. Other
+ *        failures, e.g. a NACK of a device still converting, leave the bus
+ *        as it is.
+ *
+ * \return bool : true when the bus was stuck and is free again
+ */
+static bool htu21_dev_recover(struct htu21_device *dev, esp_err_t err)
+{
+    struct htu21_metrics *metrics = __atomic_load_n(&dev->metrics, __ATOMIC_ACQUIRE);
+    int64_t start_us = esp_timer_get_time();
+    enum htu21_bus_recovery recovery;
+
+    // A device holding SDA low makes the transfers time out, a NACK needs no recovery
+    if (err != ESP_ERR_TIMEOUT)
+        return false;
+
+    recovery = htu21_bus_recover(dev->bus);
+    if (recovery == htu21_bus_not_stuck)
+        return false;
+
+    if (metrics != NULL) {
+        metrics->bus_recoveries++;
+        metrics->bus_recovery_time_us += (uint32_t) (esp_timer_get_time() - start_us);
+        if (recovery == htu21_bus_still_stuck)
+            metrics->bus_recovery_failures++;
+    }
+    if (recovery == htu21_bus_still_stuck)
+        ESP_LOGE(TAG, "I2C bus still stuck after recovery (device 0x%02x)", dev->address);
+
+    return recovery == htu21_bus_recovered;
+}
+
+/**
+ * \brief Prepares the bus for a transfer with the device, bus lock held :
+ *        speed profile, and channel when the device is behind a mux.
+ */
+static esp_err_t htu21_dev_select(struct htu21_device *dev, uint32_t timeout_us)
+{
+    htu21_dev_apply_speed(dev);
+    if (dev->mux == NULL)
+        return ESP_OK;
+    return htu21_mux_select(dev->mux, dev->channel, timeout_us);
+}
+
+/**
+ * \brief Transfer with the device, bus lock held : write only when buffer is
+ *        NULL, read only when data is NULL, else write then read. A transfer
+ *        that fails on a stuck bus is retried once after recovery.
+ */
+static esp_err_t htu21_dev_transfer(struct htu21_device *dev, const uint8_t *data, uint16_t length,
+                                    uint8_t *buffer, uint16_t buffer_length)
+{
+    const struct htu21_bus_ops *ops = dev->bus->ops;
+    void *context = dev->bus->context;
+    bool retry = true;
+    int64_t start_us;
+    esp_err_t err;
+
+    for (;;) {
+        uint32_t timeout = htu21_transfer_timeout(dev, htu21_config_load(dev));
+
+        start_us = esp_timer_get_time();
+        err = htu21_dev_select(dev, timeout);
+        if (err == ESP_OK) {
+            if (buffer == NULL)
+                err = ops->write(context, dev->address, data, length, timeout);
+            else if (data == NULL)
+                err = ops->read(context, dev->address, buffer, buffer_length, timeout);
+            else
+                err = ops->write_read(context, dev->address, data, length, buffer, buffer_length, timeout);
+        }
+        htu21_dev_account(dev, err, length + buffer_length + ((data != NULL && buffer != NULL) ? 2 : 1),
+                          esp_timer_get_time() - start_us);
+
+        if (err == ESP_OK)
+            return ESP_OK;
+        if (dev->mux != NULL)
+            htu21_mux_invalidate(dev->mux);
+        if (!retry || !htu21_dev_recover(dev, err))
+            return err;
+        retry = false;
+    }
+}
+
+static inline esp_err_t htu21_dev_write(struct htu21_device *dev, const uint8_t *data, uint16_t length)
+{
+    return htu21_dev_transfer(dev, data, length, NULL, 0);
+}
+
+static inline esp_err_t htu21_dev_read(struct htu21_device *dev, uint8_t *buffer, uint16_t length)
+{
+    return htu21_dev_transfer(dev, NULL, 0, buffer, length);
+}
+
+static inline esp_err_t htu21_dev_write_read(struct htu21_device *dev, const uint8_t *data, uint16_t length,
+                                             uint8_t *buffer, uint16_t buffer_length)
+{
+    return htu21_dev_transfer(dev, data, length, buffer, buffer_length);
+}
+
+// One exchange of htu21_fleet_init with each device : a write, then a read when
+// buffer is not NULL. Device i uses the data and buffer at i times the stride.
+struct htu21_fleet_exchange {
+    const uint8_t *data;
+    size_t data_stride;
+    uint16_t length;
+    uint8_t *buffer;
+    size_t buffer_stride;
+    uint16_t buffer_length;
+};
+
+/**
+ * \brief Queues the channel select of the device in a batch, when the device
+ *        is behind a mux and its channel is not the one last selected.
+ */
+static inline void htu21_dev_batch_select(struct htu21_device *dev, struct htu21_bus_batch *batch)
+{
+    if (dev->mux != NULL)
+        htu21_mux_batch_select(dev->mux, batch, dev->channel);
+}
+
+/**
+ * \brief Runs a batch holding the transfers of the devices whose status is
+ *        ok, bus lock held. The bus runs at the slowest profile of these
+ *        devices, and the time of the batch is shared between them.
+ *
+ * \param[in] uint16_t : Bytes moved per device, mux selects excluded
+ */
+static esp_err_t htu21_dev_batch_submit(struct htu21_device **devices, uint32_t count,
+                                        const enum htu21_status *status, const struct htu21_bus_batch *batch,
+                                        uint16_t bytes)
+{
+    uint32_t scl_hz = 0, stretch_timeout = 0, timeout = 0, served = 0, i;
+    int64_t start_us, elapsed_us;
+    esp_err_t err;
+
+    for (i = 0; i < count; i++) {
+        uint32_t config = htu21_config_load(devices[i]);
+        uint32_t device_hz = __atomic_load_n(&devices[i]->scl_hz, __ATOMIC_RELAXED);
+        // Batched transfers are in no hold master mode, the devices never stretch for a conversion
+        uint32_t device_timeout = htu21_stretch_timeout(devices[i], config & ~HTU21_CONFIG_HOLD_MASTER);
+
+        if (status[i] != htu21_status_ok)
+            continue;
+        // Each device of the batch adds its own budget
+        timeout += htu21_transfer_timeout(devices[i], config & ~HTU21_CONFIG_HOLD_MASTER);
+        served++;
+        if (device_hz == 0)
+            continue;
+        if (scl_hz == 0 || device_hz < scl_hz)
+            scl_hz = device_hz;
+        if (device_timeout > stretch_timeout)
+            stretch_timeout = device_timeout;
+    }
+    if (scl_hz != 0)
+        htu21_bus_set_speed(devices[0]->bus, scl_hz, stretch_timeout);
+
+    start_us = esp_timer_get_time();
+    err = htu21_bus_batch_submit(devices[0]->bus, batch, timeout);
+    elapsed_us = (served != 0) ? (esp_timer_get_time() - start_us) / served : 0;
+
+    for (i = 0; i < count; i++)
+        if (status[i] == htu21_status_ok)
+            htu21_dev_account(devices[i], err, bytes, elapsed_us);
+
+    // Recovered before the transfers are retried one by one
+    for (i = 0; i < count && err != ESP_OK; i++)
+        if (devices[i]->mux != NULL)
+            htu21_mux_invalidate(devices[i]->mux);
+    for (i = 0; i < count && err != ESP_OK; i++) {
+        if (status[i] == htu21_status_ok) {
+            htu21_dev_recover(devices[i], err);
+            break;
+        }
+    }
+
+    return err;
+}
+
+/**
+ * \brief Checks and assembles the 14 bytes returned by the two serial number
+ *        reads.
+ */
+static enum htu21_status htu21_serial_number_decode(const uint8_t *rcv_data, uint64_t *serial_number)
+{
+    enum htu21_status status;
+    uint8_t i;
+
+    for (i = 0; i < 8; i += 2) {
+        status = htu21_crc_check(rcv_data[i], rcv_data[i + 1]);
+        if (status != htu21_status_ok)
+            return status;
+    }
+    for (i = 8; i < 14; i += 3) {
+        status = htu21_crc_check(((rcv_data[i] << 8) | (rcv_data[i + 1])), rcv_data[i + 2]);
+        if (status != htu21_status_ok)
+            return status;
+    }
+
+    *serial_number = ((uint64_t) rcv_data[0] << 56) | ((uint64_t) rcv_data[2] << 48) | ((uint64_t) rcv_data[4] << 40) |
+                     ((uint64_t) rcv_data[6] << 32)
+                     | ((uint64_t) rcv_data[8] << 24) | ((uint64_t) rcv_data[9] << 16) |
+                     ((uint64_t) rcv_data[11] << 8) | ((uint64_t) rcv_data[12] << 0);
+
+    return htu21_status_ok;
+}
+
+/**
+ * \brief Waits for the end of a conversion, bus lock held on entry and on
+ *        return. In no hold master mode the bus is released during the wait
+ *        and its end reserved, so that other devices and drivers use the bus
+ *        meanwhile. In hold master mode the device stretches the clock, the
+ *        bus is kept.
+ */
+static void htu21_conversion_wait(struct htu21_device *dev, uint32_t config, uint32_t conversion_time)
+{
+    int slot = -1;
+
+    dev->conversion_done_us = esp_timer_get_time() + conversion_time;
+    if (!(config & HTU21_CONFIG_HOLD_MASTER))
+        slot = htu21_bus_reserve(dev->bus, dev->conversion_done_us);
+
+    if (slot >= 0)
+        htu21_bus_unlock(dev->bus);
+    htu21_wait_us(conversion_time);
+    if (slot >= 0) {
+        htu21_bus_lock(dev->bus);
+        htu21_bus_release_reservation(dev->bus, slot);
+    }
+}
+
+/**
+ * \brief Sets the end of a conversion triggered now, device acquired.
+ *
+ * \return int64_t - Time of the trigger (us).
+ */
+static int64_t htu21_conversion_schedule(struct htu21_device *dev, enum htu21_measurement measurement)
+{
+    const struct htu21_family *family = htu21_dev_family(dev);
+    enum htu21_resolution resolution = htu21_config_resolution(htu21_config_load(dev));
+    int64_t start_us = esp_timer_get_time();
+
+    dev->conversion_done_us = start_us + ((measurement == htu21_measurement_temperature)
+                                          ? family->temperature_conversion_time[resolution]
+                                          : family->humidity_conversion_time[resolution]);
+    return start_us;
+}
+
+/**
+ * \brief Accounts a conversion about to be triggered, device acquired.
+ *        Triggering the temperature accounts the whole measurement in the
+ *        governor and the thermal model. With
+ *        HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY a measurement may be a
+ *        humidity conversion alone : each conversion accounts its own time.
+ *
+ * \return uint8_t - Trigger command of the conversion.
+ */
+static uint8_t htu21_conversion_prepare(struct htu21_device *dev, enum htu21_measurement measurement)
+{
+    struct htu21_governor *governor = __atomic_load_n(&dev->governor, __ATOMIC_ACQUIRE);
+    struct htu21_thermal_model *model = __atomic_load_n(&dev->thermal_model, __ATOMIC_ACQUIRE);
+    const struct htu21_family *family = htu21_dev_family(dev);
+    enum htu21_resolution resolution = htu21_config_resolution(htu21_config_load(dev));
+    int64_t start_us = htu21_conversion_schedule(dev, measurement);
+    uint32_t measurement_time = 0;
+
+    if (htu21_family_has(family, HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY))
+        measurement_time = (measurement == htu21_measurement_temperature)
+                           ? family->temperature_conversion_time[resolution]
+                           : family->humidity_conversion_time[resolution];
+    else if (measurement == htu21_measurement_temperature)
+        measurement_time = family->temperature_conversion_time[resolution]
+                           + family->humidity_conversion_time[resolution];
+
+    if (measurement_time != 0) {
+        if (governor != NULL)
+            htu21_governor_record(governor, start_us, measurement_time);
+        if (model != NULL)
+            htu21_thermal_record_conversion(model, start_us, measurement_time);
+    }
+
+    return (measurement == htu21_measurement_temperature) ? HTU21_READ_TEMPERATURE_WO_HOLD_COMMAND
+                                                          : HTU21_READ_HUMIDITY_WO_HOLD_COMMAND;
+}
+
+/**
+ * \brief Marks the device measuring once its trigger went out, bus lock held.
+ */
+static void htu21_conversion_started(struct htu21_device *dev, bool triggered)
+{
+    if (triggered) {
+        dev->measuring = true;
+        dev->reservation = htu21_bus_reserve(dev->bus, dev->conversion_done_us);
+    }
+}
+
+/**
+ * \brief Converts the result of a conversion and ends the measurement, bus
+ *        lock held.
+ *
+ * \param[in] uint8_t* : Bytes read, NULL when the read failed
+ */
+static enum htu21_status htu21_conversion_fetched(struct htu21_device *dev, enum htu21_measurement measurement,
+                                                  const uint8_t *buffer, htu21_real_t *value)
+{
+    struct htu21_thermal_model *model = __atomic_load_n(&dev->thermal_model, __ATOMIC_ACQUIRE);
+    enum htu21_resolution resolution = htu21_config_resolution(htu21_config_load(dev));
+    enum htu21_status status;
+    uint16_t adc = 0;
+
+    if (buffer == NULL) {
+        status = htu21_status_i2c_transfer_error;
+    } else {
+        adc = (buffer[0] << 8) | buffer[1];
+        status = htu21_crc_check(adc, buffer[2]);
+    }
+
+    if (status == htu21_status_ok) {
+        if (measurement == htu21_measurement_temperature) {
+            *value = htu21_dev_convert_temperature(dev, resolution, adc);
+            if (model != NULL)
+                *value = HTU21_REAL_FROM_FLOAT(htu21_thermal_correct_temperature(model, dev->conversion_done_us,
+                                                                                 HTU21_REAL_TO_FLOAT(*value)));
+        } else {
+            *value = htu21_dev_convert_humidity(dev, resolution, adc);
+        }
+    }
+
+    htu21_bus_release_reservation(dev->bus, dev->reservation);
+    dev->reservation = -1;
+    dev->measuring = false;
+
+    return status;
+}
+
 void i2c_master_init(void) {
     i2c_config_t *i2c_cfg_0 = get_i2c_num_0_cfg();
     if (i2c_cfg_0 == NULL) {
@@ -144,10 +720,51 @@ void i2c_master_init(void) {
  */
 void htu21_init(void)
 {
-    i2c_master_mode = htu21_i2c_no_hold;
+    htu21_set_i2c_master_mode(htu21_i2c_no_hold);
 
     /* Initialize and enable device with config. */
     i2c_master_init();
+    // The default bus keeps its lock when initialized again
+    if (htu21_default_bus.lock == NULL
+        && htu21_bus_init(&htu21_default_bus, &htu21_bus_esp32_ops, NULL) != ESP_OK)
+        ESP_LOGE(TAG, "ERROR:  htu21_bus_init() could not create the bus lock.");
+}
+
+/**
+ * \brief Initializes a device. Resolution T 14b / RH 12b, no hold master mode,
+ *        HTU21D family until its serial number is read.
+ *
+ * \param[out] htu21_device* : Device to initialize
+ * \param[in] htu21_bus* : Bus the device is attached to (see htu21d_bus.h)
+ * \param[in] uint8_t : I2C address
+ */
+void htu21_dev_init(struct htu21_device *dev, struct htu21_bus *bus, uint8_t address)
+{
+    dev->bus = bus;
+    dev->address = address;
+    dev->config = htu21_resolution_t_14b_rh_12b;
+    dev->governor = NULL;
+    dev->thermal_model = NULL;
+    dev->measuring = false;
+    dev->conversion_done_us = 0;
+    dev->reservation = -1;
+    dev->waiters = NULL;
+    dev->metrics = NULL;
+    dev->scl_hz = 0;
+    dev->mux = NULL;
+    dev->channel = 0;
+    dev->family = &htu21_family_htu21d;
+    dev->calibrated = false;
+}
+
+/**
+ * \brief Returns the device used by the functions without device argument.
+ *
+ * \return htu21_device* - Default device.
+ */
+struct htu21_device *htu21_get_default_device(void)
+{
+    return &htu21_default_device;
 }
 
 /**
@@ -158,17 +775,25 @@ void htu21_init(void)
  *       - false : Device is not acknowledging I2C address
   */
 bool htu21_is_connected(void) {
-    enum status_code i2c_status;
+    return htu21_dev_is_connected(&htu21_default_device);
+}
 
-    struct i2c_master_packet transfer = {
-            .address     = HTU21_ADDR,
-            .data_length = 0,
-            .data        = NULL,
-    };
+/**
+ * \brief Check whether the device is connected
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return bool : status of HTU21
+ *       - true : Device is present
+ *       - false : Device is not acknowledging I2C address
+ */
+bool htu21_dev_is_connected(struct htu21_device *dev) {
     /* Do the transfer */
-    esp_err_t err = write_address(HTU21_ADDR);
+    htu21_dev_acquire(dev);
+    esp_err_t err = htu21_dev_write(dev, NULL, 0);
+    htu21_dev_release(dev);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "write_address(HTU21D_ADDR(0x%.2x) returned error code: %d", HTU21_ADDR, err);
+        ESP_LOGD(TAG, "write_address(HTU21D_ADDR(0x%.2x) returned error code: %d", dev->address, err);
         return false;
     }
     return true;
@@ -183,11 +808,28 @@ bool htu21_is_connected(void) {
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
 enum htu21_status htu21_reset(void) {
+    return htu21_dev_reset(&htu21_default_device);
+}
+
+/**
+ * \brief Reset the device
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_reset(struct htu21_device *dev) {
     enum htu21_status status;
-    esp_err_t err = write_byte(HTU21_ADDR, HTU21_RESET_COMMAND);
+    uint8_t cmd = HTU21_RESET_COMMAND;
+
+    htu21_dev_acquire(dev);
+    esp_err_t err = htu21_dev_write(dev, &cmd, 1);
     status = (err == ESP_OK) ? htu21_status_ok : htu21_status_i2c_transfer_error;
-    htu21_temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_14b_RH_12b;
-    htu21_humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_14b_RH_12b;
+    htu21_config_update(dev, HTU21_CONFIG_RESOLUTION_MASK, htu21_resolution_t_14b_rh_12b);
+    htu21_dev_release(dev);
     return status;
 }
 
@@ -199,10 +841,22 @@ enum htu21_status htu21_reset(void) {
  *
  */
 void htu21_set_i2c_master_mode(enum htu21_i2c_master_mode mode) {
-    i2c_master_mode = mode;
+    htu21_dev_set_i2c_master_mode(&htu21_default_device, mode);
     return;
 }
 
+/**
+ * \brief Set I2C master mode of the device. A device with a speed profile
+ *        whose bus cannot stretch the clock for a whole conversion (e.g. the
+ *        ESP32, about 13 ms) is measured in no hold master mode.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_i2c_master_mode : I2C mode
+ */
+void htu21_dev_set_i2c_master_mode(struct htu21_device *dev, enum htu21_i2c_master_mode mode) {
+    htu21_config_update(dev, HTU21_CONFIG_HOLD_MASTER, (mode == htu21_i2c_hold) ? HTU21_CONFIG_HOLD_MASTER : 0);
+}
+
 /**
  * \brief Writes the HTU21 8-bits command with the value passed
  *
@@ -272,55 +926,24 @@ void htu21_set_i2c_master_mode(enum htu21_i2c_master_mode mode) {
 //}
 
 /**
- * \brief Check CRC
+ * \brief Reads the HTU21 user register. Bus lock held by the caller.
  *
- * \param[in] uint16_t : variable on which to check CRC
- * \param[in] uint8_t : CRC value
+ * \param[in] htu21_device* : Device
+ * \param[out] uint8_t* : Storage of user register value
  *
  * \return htu21_status : status of HTU21
- *       - htu21_status_ok : CRC check is OK
- *       - htu21_status_crc_error : CRC check error
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
-enum htu21_status htu21_crc_check( uint16_t value, uint8_t crc)
+enum htu21_status htu21_read_user_register(struct htu21_device *dev, uint8_t *value)
 {
-    uint32_t polynom = 0x988000; // x^8 + x^5 + x^4 + 1
-    uint32_t msb = 0x800000;
-    uint32_t mask = 0xFF8000;
-    uint32_t result = (uint32_t) value << 8; // Pad with zeros as specified in spec
-
-    while (msb != 0x80) {
+    uint8_t cmd = HTU21_READ_USER_REG_COMMAND;
 
-        // Check if msb of current value is 1 and apply XOR mask
-        if (result & msb)
-            result = ((result ^ polynom) & mask) | (result & ~mask);
-
-        // Shift by one
-        msb >>= 1;
-        mask >>= 1;
-        polynom >>= 1;
-    }
-    if (result == crc)
-        return htu21_status_ok;
-    else
-        return htu21_status_crc_error;
-}
-
-/**
- * \brief Reads the HTU21 user register.
- *
- * \param[out] uint8_t* : Storage of user register value
- *
- * \return htu21_status : status of HTU21
- *       - htu21_status_ok : I2C transfer completed successfully
- *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
- *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
- */
-enum htu21_status htu21_read_user_register(uint8_t *value)
-{
-//    enum htu21_status status;
-//    enum status_code i2c_status;
-//    uint8_t buffer[1];
-//    buffer[0] = 0;
+//    enum htu21_status status;
+//    enum status_code i2c_status;
+//    uint8_t buffer[1];
+//    buffer[0] = 0;
 
     /* Read data */
 //    struct i2c_master_packet read_transfer = {
@@ -330,7 +953,9 @@ enum htu21_status htu21_read_user_register(uint8_t *value)
 //    };
 
     // Send the Read Register Command
-    *value = read_register_8(HTU21_ADDR, HTU21_READ_USER_REG_COMMAND);
+    esp_err_t err = htu21_dev_write_read(dev, &cmd, 1, value, 1);
+    if (err != ESP_OK)
+        return htu21_status_i2c_transfer_error;
 
 ////    status = htu21_write_command(HTU21_READ_USER_REG_COMMAND);
 //    if (err != ESP_OK) {
@@ -352,7 +977,9 @@ enum htu21_status htu21_read_user_register(uint8_t *value)
 /**
  * \brief Writes the htu21 user register with value
  *        Will read and keep the unreserved bits of the register
+ *        Bus lock held by the caller.
  *
+ * \param[in] htu21_device* : Device
  * \param[in] uint8_t : Register value to be set.
  *
  * \return htu21_status : status of HTU21
@@ -360,14 +987,14 @@ enum htu21_status htu21_read_user_register(uint8_t *value)
  *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
-enum htu21_status htu21_write_user_register(uint8_t value)
+enum htu21_status htu21_write_user_register(struct htu21_device *dev, uint8_t value)
 {
     enum htu21_status status;
     enum status_code i2c_status;
     uint8_t reg;
     uint8_t data[2];
 
-    status = htu21_read_user_register(&reg);
+    status = htu21_read_user_register(dev, &reg);
     if (status != htu21_status_ok)
         return status;
 
@@ -385,20 +1012,26 @@ enum htu21_status htu21_write_user_register(uint8_t value)
 //        .data        = data,
 //    };
 
+    data[0] = HTU21_WRITE_USER_REG_COMMAND;
+    data[1] = reg;
+
     /* Do the transfer */
-    uint16_t len = write_register(HTU21_ADDR, HTU21_WRITE_USER_REG_COMMAND, &reg, 1);
+    esp_err_t err = htu21_dev_write(dev, data, 2);
 //    i2c_status = i2c_master_write_packet_wait(&transfer);
 //    if( i2c_status == STATUS_ERR_OVERFLOW )
 //        return htu21_status_no_i2c_acknowledge;
 //    if( i2c_status != STATUS_OK)
 //        return htu21_status_i2c_transfer_error;
 
-    return (len == 1) ? htu21_status_ok : htu21_status_i2c_transfer_error;
+    return (err == ESP_OK) ? htu21_status_ok : htu21_status_i2c_transfer_error;
 }
 
 /**
- * \brief Reads the temperature ADC value
+ * \brief Reads the temperature ADC value. Bus lock held by the caller,
+ *        released during the conversion (see htu21_conversion_wait).
  *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : Configuration word sampled under the bus lock
  * \param[out] uint16_t* : Temperature ADC value.
  *
  * \return htu21_status : status of HTU21
@@ -407,7 +1040,7 @@ enum htu21_status htu21_write_user_register(uint8_t value)
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  *       - htu21_status_crc_error : CRC check error
  */
-enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *adc)
+enum htu21_status htu21_temperature_conversion_and_read_adc(struct htu21_device *dev, uint32_t config, uint16_t *adc)
 {
     enum htu21_status status = htu21_status_ok;
     enum status_code i2c_status;
@@ -426,13 +1059,14 @@ enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *adc)
 //        .data        = buffer,
 //    };
 
-    uint8_t cmd = (i2c_master_mode == htu21_i2c_hold) ? HTU21_READ_TEMPERATURE_W_HOLD_COMMAND
+    uint8_t cmd = (config & HTU21_CONFIG_HOLD_MASTER) ? HTU21_READ_TEMPERATURE_W_HOLD_COMMAND
                                                       : HTU21_READ_TEMPERATURE_WO_HOLD_COMMAND;
-    esp_err_t w_err = write_byte(HTU21_ADDR, cmd);
+    esp_err_t w_err = htu21_dev_write(dev, &cmd, 1);
     if (w_err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
-    vTaskDelay((htu21_temperature_conversion_time / 1000) / portTICK_PERIOD_MS);
+    htu21_conversion_wait(dev, config,
+                          htu21_dev_family(dev)->temperature_conversion_time[htu21_config_resolution(config)]);
 //    delay_ms(htu21_temperature_conversion_time/1000);
 //    if( i2c_master_mode == htu21_i2c_hold) {
 //        status = htu21_write_command_no_stop(HTU21_READ_TEMPERATURE_W_HOLD_COMMAND);
@@ -444,8 +1078,8 @@ enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *adc)
 //    if( status != htu21_status_ok)
 //        return status;
 
-    uint16_t len_read = read_bytes(HTU21_ADDR, buffer, 3);
-    if (len_read != 3) {
+    esp_err_t r_err = htu21_dev_read(dev, buffer, 3);
+    if (r_err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
 ////    i2c_status = i2c_master_read_packet_wait(&read_transfer);
@@ -468,8 +1102,11 @@ enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *adc)
 }
 
 /**
- * \brief Reads the relative humidity ADC value
+ * \brief Reads the relative humidity ADC value. Bus lock held by the caller,
+ *        released during the conversion (see htu21_conversion_wait).
  *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : Configuration word sampled under the bus lock
  * \param[out] uint16_t* : Relative humidity ADC value.
  *
  * \return htu21_status : status of HTU21
@@ -478,7 +1115,7 @@ enum htu21_status htu21_temperature_conversion_and_read_adc( uint16_t *adc)
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  *       - htu21_status_crc_error : CRC check error
  */
-enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *adc)
+enum htu21_status htu21_humidity_conversion_and_read_adc(struct htu21_device *dev, uint32_t config, uint16_t *adc)
 {
     enum htu21_status status = htu21_status_ok;
     enum status_code i2c_status;
@@ -496,14 +1133,15 @@ enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *adc)
 //        .data_length = 3,
 //        .data        = buffer,
 //    };
-    uint8_t cmd = (i2c_master_mode == htu21_i2c_hold) ? HTU21_READ_HUMIDITY_W_HOLD_COMMAND
+    uint8_t cmd = (config & HTU21_CONFIG_HOLD_MASTER) ? HTU21_READ_HUMIDITY_W_HOLD_COMMAND
                                                       : HTU21_READ_HUMIDITY_WO_HOLD_COMMAND;
-    esp_err_t w_err = write_byte(HTU21_ADDR, cmd);
+    esp_err_t w_err = htu21_dev_write(dev, &cmd, 1);
     if (w_err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
 
-    vTaskDelay((htu21_humidity_conversion_time / 1000) / portTICK_PERIOD_MS);
+    htu21_conversion_wait(dev, config,
+                          htu21_dev_family(dev)->humidity_conversion_time[htu21_config_resolution(config)]);
 //    delay_ms(htu21_humidity_conversion_time/1000);
 
 //    if( i2c_master_mode == htu21_i2c_hold) {
@@ -521,8 +1159,8 @@ enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *adc)
 //        return htu21_status_no_i2c_acknowledge;
 //    if( i2c_status != STATUS_OK)
 //        return htu21_status_i2c_transfer_error;
-    uint16_t len_read = read_bytes(HTU21_ADDR, buffer, 3);
-    if (len_read != 3) {
+    esp_err_t r_err = htu21_dev_read(dev, buffer, 3);
+    if (r_err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
 
@@ -539,6 +1177,33 @@ enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *adc)
     return status;
 }
 
+/**
+ * \brief Reads the temperature ADC value measured by the last humidity
+ *        conversion, with HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY. No
+ *        conversion, and no CRC in the answer. Bus lock held by the caller.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_family* : Family of the device
+ * \param[out] uint16_t* : Temperature ADC value.
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ */
+enum htu21_status htu21_previous_temperature_read_adc(struct htu21_device *dev, const struct htu21_family *family,
+                                                      uint16_t *adc)
+{
+    uint8_t cmd = family->read_previous_temperature_command;
+    uint8_t buffer[2];
+
+    if (htu21_dev_write_read(dev, &cmd, 1, buffer, 2) != ESP_OK)
+        return htu21_status_i2c_transfer_error;
+
+    *adc = (buffer[0] << 8) | buffer[1];
+
+    return htu21_status_ok;
+}
+
 /**
  * \brief Reads the htu21 serial number.
  *
@@ -551,20 +1216,28 @@ enum htu21_status htu21_humidity_conversion_and_read_adc( uint16_t *adc)
  *       - htu21_status_crc_error : CRC check error
  */
 enum htu21_status htu21_read_serial_number(uint64_t * serial_number)
+{
+    return htu21_dev_read_serial_number(&htu21_default_device, serial_number);
+}
+
+/**
+ * \brief Reads the serial number of the device, and sets its family from it,
+ *        device acquired.
+ */
+static enum htu21_status htu21_serial_number_fetch(struct htu21_device *dev, uint64_t *serial_number)
 {
     enum htu21_status status;
     enum status_code i2c_status;
     uint8_t cmd_data[2];
     uint8_t rcv_data[14];
-    uint8_t i;
 
     struct i2c_master_packet transfer = {
-            .address     = HTU21_ADDR,
+            .address     = dev->address,
             .data_length = 2,
             .data        = cmd_data,
     };
     struct i2c_master_packet read_transfer = {
-            .address     = HTU21_ADDR,
+            .address     = dev->address,
             .data_length = 8,
             .data        = rcv_data,
     };
@@ -581,18 +1254,13 @@ enum htu21_status htu21_read_serial_number(uint64_t * serial_number)
 //    if( i2c_status != STATUS_OK)
 //        return htu21_status_i2c_transfer_error;
 
-    esp_err_t err = write_byte(HTU21_ADDR, (HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND >> 8) & 0xFF);
-    if (err != ESP_OK) {
-        return htu21_status_i2c_transfer_error;
-    }
-    err = write_byte(HTU21_ADDR, HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND & 0xFF);
+    cmd_data[0] = (HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND >> 8) & 0xFF;
+    cmd_data[1] = HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND & 0xFF;
+
+    esp_err_t err = htu21_dev_write_read(dev, cmd_data, 2, rcv_data, 8);
     if (err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
-    uint16_t len_read = read_bytes(HTU21_ADDR, rcv_data, 8);
-    if (len_read != 8) {
-        return htu21_status_i2c_transfer_error;
-    }
 
 //    // Read the last 6 bytes
 //    cmd_data[0] = (HTU21_READ_SERIAL_LAST_6BYTES_COMMAND>>8)&0xFF;
@@ -609,37 +1277,79 @@ enum htu21_status htu21_read_serial_number(uint64_t * serial_number)
 //    if( i2c_status != STATUS_OK)
 //        return htu21_status_i2c_transfer_error;
 
-    err = write_byte(HTU21_ADDR, (HTU21_READ_SERIAL_LAST_6BYTES_COMMAND >> 8) & 0xFF);
-    if (err != ESP_OK) {
-        return htu21_status_i2c_transfer_error;
-    }
-    err = write_byte(HTU21_ADDR, HTU21_READ_SERIAL_LAST_6BYTES_COMMAND & 0xFF);
+    cmd_data[0] = (HTU21_READ_SERIAL_LAST_6BYTES_COMMAND >> 8) & 0xFF;
+    cmd_data[1] = HTU21_READ_SERIAL_LAST_6BYTES_COMMAND & 0xFF;
+
+    err = htu21_dev_write_read(dev, cmd_data, 2, &rcv_data[8], 6);
     if (err != ESP_OK) {
         return htu21_status_i2c_transfer_error;
     }
-    len_read = read_bytes(HTU21_ADDR, &rcv_data[8], 6);
-    if (len_read != 6) {
-        return htu21_status_i2c_transfer_error;
-    }
 
-    for (i = 0; i < 8; i += 2) {
-        status = htu21_crc_check(rcv_data[i], rcv_data[i + 1]);
-        if (status != htu21_status_ok)
-            return status;
-    }
-    for (i = 8; i < 14; i += 3) {
-        status = htu21_crc_check(((rcv_data[i] << 8) | (rcv_data[i + 1])), rcv_data[i + 2]);
-        if (status != htu21_status_ok)
-            return status;
+    status = htu21_serial_number_decode(rcv_data, serial_number);
+    if (status == htu21_status_ok)
+        __atomic_store_n(&dev->family, htu21_family_detect(*serial_number), __ATOMIC_RELEASE);
+
+    return status;
+}
+
+/**
+ * \brief Reads the serial number of the device, and sets its family from it
+ *        (see htu21d_family.h).
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] uint64_t* : Serial number
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_dev_read_serial_number(struct htu21_device *dev, uint64_t * serial_number)
+{
+    enum htu21_status status;
+
+    htu21_dev_acquire(dev);
+    status = htu21_serial_number_fetch(dev, serial_number);
+    htu21_dev_release(dev);
+
+    return status;
+}
+
+/**
+ * \brief Probes the device and reads its serial number without waiting for
+ *        the bus : skipped when the bus is taken, the device is measuring, or
+ *        a conversion reserved on the bus ends within the time of the probe.
+ *        Sets the family of the device from the serial number.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : Bus time of the probe (us)
+ * \param[out] uint64_t* : Serial number
+ * \param[out] htu21_status* : Status of the probe
+ *       - htu21_status_ok : Serial number read
+ *       - htu21_status_no_i2c_acknowledge : Device not answering
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_crc_error : CRC check error
+ *
+ * \return bool : false when the probe was skipped
+ */
+bool htu21_dev_try_identify(struct htu21_device *dev, uint32_t cost_us, uint64_t *serial_number,
+                            enum htu21_status *status)
+{
+    if (!htu21_bus_try_lock(dev->bus, 0))
+        return false;
+    if (dev->measuring || htu21_bus_idle_time(dev->bus, esp_timer_get_time()) < cost_us) {
+        htu21_bus_unlock(dev->bus);
+        return false;
     }
 
-    *serial_number = ((uint64_t) rcv_data[0] << 56) | ((uint64_t) rcv_data[2] << 48) | ((uint64_t) rcv_data[4] << 40) |
-                     ((uint64_t) rcv_data[6] << 32)
-                     | ((uint64_t) rcv_data[8] << 24) | ((uint64_t) rcv_data[9] << 16) |
-                     ((uint64_t) rcv_data[11] << 8) | ((uint64_t) rcv_data[12] << 0);
+    if (htu21_dev_write(dev, NULL, 0) != ESP_OK)
+        *status = htu21_status_no_i2c_acknowledge;
+    else
+        *status = htu21_serial_number_fetch(dev, serial_number);
+    htu21_dev_release(dev);
 
-    return htu21_status_ok;
-    
+    return true;
 }
 
 /**
@@ -654,46 +1364,60 @@ enum htu21_status htu21_read_serial_number(uint64_t * serial_number)
  *       - htu21_status_crc_error : CRC check error
  */
 enum htu21_status htu21_set_resolution(enum htu21_resolution res)
+{
+    return htu21_dev_set_resolution(&htu21_default_device, res);
+}
+
+/**
+ * \brief Set temperature & humidity ADC resolution of the device.
+ *        The new conversion timings are published once the device accepted
+ *        the resolution, under the bus lock, so no read can use a timing that
+ *        does not match the device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_resolution : Resolution requested
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_dev_set_resolution(struct htu21_device *dev, enum htu21_resolution res)
 {
     enum htu21_status status;
-    uint8_t reg_value, tmp = 0;
-    uint32_t temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_14b_RH_12b;
-    uint32_t humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_14b_RH_12b;
-
-    if (res == htu21_resolution_t_14b_rh_12b) {
-        tmp = HTU21_USER_REG_RESOLUTION_T_14b_RH_12b;
-        temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_14b_RH_12b;
-        humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_14b_RH_12b;
-    } else if (res == htu21_resolution_t_13b_rh_10b) {
-        tmp = HTU21_USER_REG_RESOLUTION_T_13b_RH_10b;
-        temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_13b_RH_10b;
-        humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_13b_RH_10b;
-    } else if (res == htu21_resolution_t_12b_rh_8b) {
-        tmp = HTU21_USER_REG_RESOLUTION_T_12b_RH_8b;
-        temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_12b_RH_8b;
-        humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_12b_RH_8b;
-    } else if (res == htu21_resolution_t_11b_rh_11b) {
-        tmp = HTU21_USER_REG_RESOLUTION_T_11b_RH_11b;
-        temperature_conversion_time = HTU21_TEMPERATURE_CONVERSION_TIME_T_11b_RH_11b;
-        humidity_conversion_time = HTU21_HUMIDITY_CONVERSION_TIME_T_11b_RH_11b;
-    }
-
-    status = htu21_read_user_register(&reg_value);
-    if (status != htu21_status_ok)
-        return status;
+    uint8_t reg_value;
 
-    // Clear the resolution bits
-    reg_value &= ~HTU21_USER_REG_RESOLUTION_MASK;
-    reg_value |= tmp & HTU21_USER_REG_RESOLUTION_MASK;
+    res &= HTU21_CONFIG_RESOLUTION_MASK;
 
-    htu21_temperature_conversion_time = temperature_conversion_time;
-    htu21_humidity_conversion_time = humidity_conversion_time;
+    htu21_dev_acquire(dev);
+    status = htu21_read_user_register(dev, &reg_value);
+    if (status == htu21_status_ok) {
+        // Clear the resolution bits
+        reg_value &= ~HTU21_USER_REG_RESOLUTION_MASK;
+        reg_value |= htu21_user_reg_resolution[res] & HTU21_USER_REG_RESOLUTION_MASK;
 
-    status = htu21_write_user_register(reg_value);
+        status = htu21_write_user_register(dev, reg_value);
+        if (status == htu21_status_ok)
+            htu21_config_update(dev, HTU21_CONFIG_RESOLUTION_MASK, res);
+    }
+    htu21_dev_release(dev);
 
     return status;
 }
 
+/**
+ * \brief Returns the resolution last set on the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_resolution - Resolution.
+ */
+enum htu21_resolution htu21_dev_get_resolution(const struct htu21_device *dev)
+{
+    return htu21_config_resolution(htu21_config_load(dev));
+}
+
 /**
  * \brief Provide battery status
  *
@@ -707,11 +1431,31 @@ enum htu21_status htu21_set_resolution(enum htu21_resolution res)
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
 enum htu21_status htu21_get_battery_status(enum htu21_battery_status *bat)
+{
+    return htu21_dev_get_battery_status(&htu21_default_device, bat);
+}
+
+/**
+ * \brief Provide battery status of the device
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_battery_status* : Battery status
+ *                      - htu21_battery_ok,
+ *                      - htu21_battery_low
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_get_battery_status(struct htu21_device *dev, enum htu21_battery_status *bat)
 {
     enum htu21_status status;
     uint8_t reg_value;
 
-    status = htu21_read_user_register(&reg_value);
+    htu21_dev_acquire(dev);
+    status = htu21_read_user_register(dev, &reg_value);
+    htu21_dev_release(dev);
     if (status != htu21_status_ok)
         return status;
 
@@ -724,28 +1468,64 @@ enum htu21_status htu21_get_battery_status(enum htu21_battery_status *bat)
 }
 
 /**
- * \brief Enable heater
+ * \brief Sets or clears the heater bit of the device and notifies its thermal
+ *        model, in one bus critical section.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_heater_status : Requested heater state
  *
  * \return htu21_status : status of HTU21
- *       - htu21_status_ok : I2C transfer completed successfully
- *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
- *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
-enum htu21_status htu21_enable_heater(void)
+static enum htu21_status htu21_dev_write_heater(struct htu21_device *dev, enum htu21_heater_status heater)
 {
     enum htu21_status status;
+    struct htu21_thermal_model *model;
     uint8_t reg_value;
 
-    status = htu21_read_user_register(&reg_value);
-    if (status != htu21_status_ok)
-        return status;
+    htu21_dev_acquire(dev);
+    status = htu21_read_user_register(dev, &reg_value);
+    if (status == htu21_status_ok) {
+        if (heater == htu21_heater_on)
+            reg_value |= HTU21_USER_REG_ONCHIP_HEATER_ENABLE;
+        else
+            reg_value &= ~HTU21_USER_REG_ONCHIP_HEATER_ENABLE;
+
+        status = htu21_write_user_register(dev, reg_value);
+        model = __atomic_load_n(&dev->thermal_model, __ATOMIC_ACQUIRE);
+        if (status == htu21_status_ok && model != NULL)
+            htu21_thermal_set_heater(model, esp_timer_get_time(), heater);
+    }
+    htu21_dev_release(dev);
 
-    // Clear the resolution bits
-    reg_value |= HTU21_USER_REG_ONCHIP_HEATER_ENABLE;
+    return status;
+}
 
-    status = htu21_write_user_register(reg_value);
+/**
+ * \brief Enable heater
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_enable_heater(void)
+{
+    return htu21_dev_enable_heater(&htu21_default_device);
+}
 
-    return status;
+/**
+ * \brief Enable heater of the device
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_enable_heater(struct htu21_device *dev)
+{
+    return htu21_dev_write_heater(dev, htu21_heater_on);
 }
 
 /**
@@ -758,19 +1538,22 @@ enum htu21_status htu21_enable_heater(void)
  */
 enum htu21_status htu21_disable_heater(void)
 {
-    enum htu21_status status;
-    uint8_t reg_value;
-
-    status = htu21_read_user_register(&reg_value);
-    if (status != htu21_status_ok)
-        return status;
-
-    // Clear the resolution bits
-    reg_value &= ~HTU21_USER_REG_ONCHIP_HEATER_ENABLE;
-
-    status = htu21_write_user_register(reg_value);
+    return htu21_dev_disable_heater(&htu21_default_device);
+}
 
-    return status;
+/**
+ * \brief Disable heater of the device
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_disable_heater(struct htu21_device *dev)
+{
+    return htu21_dev_write_heater(dev, htu21_heater_off);
 }
 
 /**
@@ -786,11 +1569,29 @@ enum htu21_status htu21_disable_heater(void)
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  */
 enum htu21_status htu21_get_heater_status(enum htu21_heater_status *heater)
+{
+    return htu21_dev_get_heater_status(&htu21_default_device, heater);
+}
+
+/**
+ * \brief Get heater status of the device
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_heater_status* : Heater status
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_get_heater_status(struct htu21_device *dev, enum htu21_heater_status *heater)
 {
     enum htu21_status status;
     uint8_t reg_value;
 
-    status = htu21_read_user_register(&reg_value);
+    htu21_dev_acquire(dev);
+    status = htu21_read_user_register(dev, &reg_value);
+    htu21_dev_release(dev);
     if (status != htu21_status_ok)
         return status;
 
@@ -806,8 +1607,30 @@ enum htu21_status htu21_get_heater_status(enum htu21_heater_status *heater)
 /**
  * \brief Reads the relative humidity value.
  *
- * \param[out] float* : Celsius Degree temperature value
- * \param[out] float* : %RH Relative Humidity value
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_read_temperature_and_relative_humidity( htu21_real_t *temperature, htu21_real_t *humidity)
+{
+    return htu21_dev_read_temperature_and_relative_humidity(&htu21_default_device, temperature, humidity);
+}
+
+/**
+ * \brief Reads the temperature and relative humidity of the device.
+ *        The configuration is sampled once the bus is held, so both
+ *        conversions use the timings of the resolution the device runs at.
+ *        Families that measure the temperature with the humidity run a single
+ *        conversion.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
  *
  * \return htu21_status : status of HTU21
  *       - htu21_status_ok : I2C transfer completed successfully
@@ -815,61 +1638,765 @@ enum htu21_status htu21_get_heater_status(enum htu21_heater_status *heater)
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  *       - htu21_status_crc_error : CRC check error
  */
-enum htu21_status htu21_read_temperature_and_relative_humidity( float *temperature, float *humidity)
+enum htu21_status htu21_dev_read_temperature_and_relative_humidity(struct htu21_device *dev,
+                                                                   htu21_real_t *temperature, htu21_real_t *humidity)
 {
     enum htu21_status status;
     uint16_t adc;
+    uint32_t config;
+    enum htu21_resolution resolution;
+    struct htu21_governor *governor = __atomic_load_n(&dev->governor, __ATOMIC_ACQUIRE);
+    struct htu21_thermal_model *model = __atomic_load_n(&dev->thermal_model, __ATOMIC_ACQUIRE);
+    const struct htu21_family *family;
+    uint32_t measurement_time;
+    int64_t start_us = 0;
+
+    if (governor != NULL) {
+        uint32_t wait = htu21_governor_next_trigger_delay(governor, esp_timer_get_time(),
+                                                          htu21_dev_get_measurement_time(dev));
+
+        // Never trigger before the governor allows it
+        htu21_wait_us(wait);
+    }
+
+    htu21_dev_acquire(dev);
+    dev->measuring = true;
+    config = htu21_dev_measurement_config(dev);
+    resolution = htu21_config_resolution(config);
+    family = htu21_dev_family(dev);
+    measurement_time = htu21_family_measurement_time(family, resolution);
+
+    if (governor != NULL || model != NULL) {
+        start_us = esp_timer_get_time();
+        if (governor != NULL)
+            htu21_governor_record(governor, start_us, measurement_time);
+        if (model != NULL)
+            htu21_thermal_record_conversion(model, start_us, measurement_time);
+    }
+
+    if (htu21_family_has(family, HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY)) {
+        // One humidity conversion, its temperature read back
+        status = htu21_humidity_conversion_and_read_adc(dev, config, &adc);
+        if (status != htu21_status_ok)
+            goto exit;
+        *humidity = htu21_dev_convert_humidity(dev, resolution, adc);
+
+        status = htu21_previous_temperature_read_adc(dev, family, &adc);
+        if (status != htu21_status_ok)
+            goto exit;
+        *temperature = htu21_dev_convert_temperature(dev, resolution, adc);
+        if (model != NULL)
+            *temperature = HTU21_REAL_FROM_FLOAT(htu21_thermal_correct_temperature(model, start_us + measurement_time,
+                                                                                   HTU21_REAL_TO_FLOAT(*temperature)));
+        goto exit;
+    }
 
-    status = htu21_temperature_conversion_and_read_adc(&adc);
+    status = htu21_temperature_conversion_and_read_adc(dev, config, &adc);
     if (status != htu21_status_ok)
-        return status;
+        goto exit;
 
     // Perform conversion function
-    *temperature = (float) adc * TEMPERATURE_COEFF_MUL / (1UL << 16) + TEMPERATURE_COEFF_ADD;
+    *temperature = htu21_dev_convert_temperature(dev, resolution, adc);
+
+    // Remove the self-heating accumulated when the temperature conversion ended
+    if (model != NULL) {
+        int64_t end_us = start_us + family->temperature_conversion_time[resolution];
+
+        *temperature = HTU21_REAL_FROM_FLOAT(htu21_thermal_correct_temperature(model, end_us,
+                                                                               HTU21_REAL_TO_FLOAT(*temperature)));
+    }
 
-    status = htu21_humidity_conversion_and_read_adc(&adc);
+    status = htu21_humidity_conversion_and_read_adc(dev, config, &adc);
     if (status != htu21_status_ok)
-        return status;
+        goto exit;
 
     // Perform conversion function
-    *humidity = (float) adc * HUMIDITY_COEFF_MUL / (1UL << 16) + HUMIDITY_COEFF_ADD;
+    *humidity = htu21_dev_convert_humidity(dev, resolution, adc);
+
+exit:
+    dev->measuring = false;
+    htu21_dev_release(dev);
+    return status;
+}
+
+/**
+ * \brief Attach a metrics block to the device. NULL detaches it.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_metrics* : Metrics (see htu21d_metrics.h)
+ */
+void htu21_dev_set_metrics(struct htu21_device *dev, struct htu21_metrics *metrics)
+{
+    __atomic_store_n(&dev->metrics, metrics, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Puts the device behind a channel of a mux on its bus. To be called
+ *        before the device is used.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_mux* : Mux, NULL for a device directly on the bus
+ * \param[in] uint8_t : Channel
+ */
+void htu21_dev_set_mux(struct htu21_device *dev, struct htu21_mux *mux, uint8_t channel)
+{
+    dev->mux = mux;
+    dev->channel = channel;
+}
+
+/**
+ * \brief Sets the family of the device, for parts whose electronic ID is not
+ *        recognized by htu21_dev_read_serial_number.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_family* : Family (see htu21d_family.h)
+ */
+void htu21_dev_set_family(struct htu21_device *dev, const struct htu21_family *family)
+{
+    __atomic_store_n(&dev->family, family, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Returns the family of the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_family* - Family (see htu21d_family.h).
+ */
+const struct htu21_family *htu21_dev_get_family(const struct htu21_device *dev)
+{
+    return htu21_dev_family(dev);
+}
+
+/**
+ * \brief Sets the calibration of the device : folds its gains and offsets
+ *        into the conversion coefficients of the device, so that calibrated
+ *        values cost no more than raw ones. NULL restores the datasheet
+ *        conversion.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_calibration* : Calibration (see htu21d_calibration.h)
+ */
+void htu21_dev_set_calibration(struct htu21_device *dev, const struct htu21_calibration *calibration)
+{
+    struct htu21_conversion conversion;
+
+    if (calibration != NULL) {
+        // gain * (code * mul + add) + offset = code * (gain * mul) + (gain * add + offset)
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+        conversion.temperature_mul = (int32_t) lroundf(calibration->temperature_gain * TEMPERATURE_COEFF_MUL);
+        conversion.temperature_add = (int32_t) lroundf(calibration->temperature_gain * TEMPERATURE_COEFF_ADD
+                                                       + calibration->temperature_offset * HTU21_REAL_SCALE);
+        conversion.humidity_mul = (int32_t) lroundf(calibration->humidity_gain * HUMIDITY_COEFF_MUL);
+        conversion.humidity_add = (int32_t) lroundf(calibration->humidity_gain * HUMIDITY_COEFF_ADD
+                                                    + calibration->humidity_offset * HTU21_REAL_SCALE);
+#else
+        conversion.temperature_mul = calibration->temperature_gain * TEMPERATURE_COEFF_MUL / (1UL << 16);
+        conversion.temperature_add = calibration->temperature_gain * TEMPERATURE_COEFF_ADD
+                                     + calibration->temperature_offset;
+        conversion.humidity_mul = calibration->humidity_gain * HUMIDITY_COEFF_MUL / (1UL << 16);
+        conversion.humidity_add = calibration->humidity_gain * HUMIDITY_COEFF_ADD + calibration->humidity_offset;
+#endif
+    }
+
+    htu21_dev_acquire(dev);
+    if (calibration != NULL)
+        dev->conversion = conversion;
+    dev->calibrated = (calibration != NULL);
+    htu21_dev_release(dev);
+}
+
+/**
+ * \brief Sets the SCL clock the bus runs at for the transfers with the device.
+ *        The clock-stretch timeout follows the resolution and master mode.
+ *        Applied when the bus switches to the device, e.g. behind a mux on a
+ *        long cable.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : SCL clock (Hz), 0 to leave the bus as it is
+ */
+void htu21_dev_set_speed(struct htu21_device *dev, uint32_t scl_hz)
+{
+    __atomic_store_n(&dev->scl_hz, scl_hz, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Returns the timeout of each transport operation with the device : a
+ *        transfer budget, plus the slowest conversion of the resolution in
+ *        hold master mode, where the device stretches the clock.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Timeout (us).
+ */
+uint32_t htu21_dev_get_transfer_timeout(struct htu21_device *dev)
+{
+    return htu21_transfer_timeout(dev, htu21_config_load(dev));
+}
+
+/**
+ * \brief Returns how long the governor of the device delays the next trigger.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Delay (us), 0 without governor.
+ */
+uint32_t htu21_dev_get_trigger_delay(struct htu21_device *dev)
+{
+    struct htu21_governor *governor = __atomic_load_n(&dev->governor, __ATOMIC_ACQUIRE);
+
+    if (governor == NULL)
+        return 0;
+    return htu21_governor_next_trigger_delay(governor, esp_timer_get_time(), htu21_dev_get_measurement_time(dev));
+}
+
+/**
+ * \brief Triggers one conversion in no hold master mode and returns at once.
+ *        The bus is released and reserved until the end of the conversion,
+ *        given by conversion_done_us of the device. Other operations on the
+ *        device wait until htu21_dev_fetch_conversion. Triggering the
+ *        temperature accounts the whole measurement in the governor and the
+ *        thermal model.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_measurement : Conversion to start
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ */
+enum htu21_status htu21_dev_start_conversion(struct htu21_device *dev, enum htu21_measurement measurement)
+{
+    uint8_t cmd;
+    esp_err_t err;
+
+    htu21_dev_acquire(dev);
+    cmd = htu21_conversion_prepare(dev, measurement);
+    err = htu21_dev_write(dev, &cmd, 1);
+    htu21_conversion_started(dev, err == ESP_OK);
+    htu21_dev_release(dev);
+
+    return (err == ESP_OK) ? htu21_status_ok : htu21_status_i2c_transfer_error;
+}
+
+/**
+ * \brief Reads the result of the conversion started by
+ *        htu21_dev_start_conversion, not before conversion_done_us.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_measurement : Conversion started
+ * \param[out] htu21_real_t* : Temperature (degC) or relative humidity (%RH)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer, or no
+ *                                           conversion started
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_dev_fetch_conversion(struct htu21_device *dev, enum htu21_measurement measurement,
+                                             htu21_real_t *value)
+{
+    enum htu21_status status;
+    uint8_t buffer[3];
+    esp_err_t err;
+
+    // The device is ours until the end of the measurement : bus lock only
+    htu21_bus_lock(dev->bus);
+    if (!dev->measuring) {
+        htu21_bus_unlock(dev->bus);
+        return htu21_status_i2c_transfer_error;
+    }
+
+    err = htu21_dev_read(dev, buffer, 3);
+    status = htu21_conversion_fetched(dev, measurement, (err == ESP_OK) ? buffer : NULL, value);
+    htu21_bus_unlock(dev->bus);
 
     return status;
 }
 
 /**
- * \brief Returns result of compensated humidity
+ * \brief Starts the same conversion on several devices of one bus, with the
+ *        triggers sent in one batch. When the batch fails, the triggers are
+ *        sent one by one so that only the failing devices report an error.
+ *        Devices whose status is not htu21_status_ok on entry are skipped.
  *
- * \param[in] float - Actual temperature measured (degC)
- * \param[in] float - Actual relative humidity measured (%RH)
+ * \param[in] htu21_device** : Devices, all on the same bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion to start
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_start_conversions(struct htu21_device **devices, uint32_t count, enum htu21_measurement measurement,
+                                 enum htu21_status *status)
+{
+    struct htu21_bus_batch batch;
+    uint8_t cmd[HTU21_BATCH_DEVICES];
+    struct htu21_bus *bus;
+    uint32_t first, i;
+    esp_err_t err;
+
+    for (first = 0; first < count; first += HTU21_BATCH_DEVICES) {
+        uint32_t last = (count - first > HTU21_BATCH_DEVICES) ? first + HTU21_BATCH_DEVICES : count;
+
+        bus = devices[first]->bus;
+        htu21_bus_lock(bus);
+
+        // A device measured by another task : one by one, waiting for it
+        for (i = first; i < last; i++)
+            if (status[i] == htu21_status_ok && devices[i]->measuring)
+                break;
+        if (i < last || bus->ops->transfer == NULL) {
+            htu21_bus_unlock(bus);
+            for (i = first; i < last; i++)
+                if (status[i] == htu21_status_ok)
+                    status[i] = htu21_dev_start_conversion(devices[i], measurement);
+            continue;
+        }
+
+        htu21_bus_batch_init(&batch);
+        for (i = first; i < last; i++) {
+            if (status[i] != htu21_status_ok)
+                continue;
+            cmd[i - first] = htu21_conversion_prepare(devices[i], measurement);
+            htu21_dev_batch_select(devices[i], &batch);
+            htu21_bus_batch_write(&batch, devices[i]->address, &cmd[i - first], 1);
+        }
+
+        err = htu21_dev_batch_submit(&devices[first], last - first, &status[first], &batch, 2);
+        for (i = first; i < last; i++) {
+            if (status[i] != htu21_status_ok)
+                continue;
+            if (err != ESP_OK) {
+                // Triggered one by one, after the failed batch
+                htu21_conversion_schedule(devices[i], measurement);
+                if (htu21_dev_write(devices[i], &cmd[i - first], 1) != ESP_OK)
+                    status[i] = htu21_status_i2c_transfer_error;
+            }
+            htu21_conversion_started(devices[i], status[i] == htu21_status_ok);
+        }
+
+        htu21_bus_unlock(bus);
+    }
+}
+
+/**
+ * \brief Reads the results of conversions started by
+ *        htu21_dev_start_conversions, with the reads sent in one batch. When
+ *        the batch fails, the results are read one by one. Devices whose
+ *        status is not htu21_status_ok on entry are skipped.
  *
- * \return float - Compensated humidity (%RH).
+ * \param[in] htu21_device** : Devices, all on the same bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion started
+ * \param[out] htu21_real_t* : Value of each device
+ * \param[in,out] htu21_status* : Status of each device
  */
-float htu21_compute_compensated_humidity(float temperature,float relative_humidity)
+void htu21_dev_fetch_conversions(struct htu21_device **devices, uint32_t count, enum htu21_measurement measurement,
+                                 htu21_real_t *values, enum htu21_status *status)
 {
-    return (relative_humidity + (25 - temperature) * HTU21_TEMPERATURE_COEFFICIENT);
+    struct htu21_bus_batch batch;
+    uint8_t buffer[HTU21_BATCH_DEVICES][3];
+    struct htu21_bus *bus;
+    uint32_t first, i;
+    esp_err_t err;
+
+    for (first = 0; first < count; first += HTU21_BATCH_DEVICES) {
+        uint32_t last = (count - first > HTU21_BATCH_DEVICES) ? first + HTU21_BATCH_DEVICES : count;
+
+        bus = devices[first]->bus;
+        if (bus->ops->transfer == NULL) {
+            for (i = first; i < last; i++)
+                if (status[i] == htu21_status_ok)
+                    status[i] = htu21_dev_fetch_conversion(devices[i], measurement, &values[i]);
+            continue;
+        }
+
+        htu21_bus_lock(bus);
+
+        htu21_bus_batch_init(&batch);
+        for (i = first; i < last; i++) {
+            if (status[i] != htu21_status_ok)
+                continue;
+            if (!devices[i]->measuring)
+                status[i] = htu21_status_i2c_transfer_error;
+            else {
+                htu21_dev_batch_select(devices[i], &batch);
+                htu21_bus_batch_read(&batch, devices[i]->address, buffer[i - first], 3);
+            }
+        }
+
+        err = htu21_dev_batch_submit(&devices[first], last - first, &status[first], &batch, 4);
+        for (i = first; i < last; i++) {
+            uint8_t *data = buffer[i - first];
+
+            if (status[i] != htu21_status_ok)
+                continue;
+            if (err != ESP_OK && htu21_dev_read(devices[i], data, 3) != ESP_OK)
+                data = NULL;
+            status[i] = htu21_conversion_fetched(devices[i], measurement, data, &values[i]);
+        }
+
+        htu21_bus_unlock(bus);
+    }
 }
 
 /**
- * \brief Returns the computed dew point
+ * \brief Runs one conversion on several devices : triggers them in one batch
+ *        per bus, waits once for the slowest, fetches them in one batch per
+ *        bus. The devices take about the wall time of one. Devices whose
+ *        status is not htu21_status_ok on entry are skipped.
  *
- * \param[in] float - Actual temperature measured (degC)
- * \param[in] float - Actual relative humidity measured (%RH)
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion to run
+ * \param[out] htu21_real_t* : Value of each device
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_run_conversions(struct htu21_device **devices, uint32_t count, enum htu21_measurement measurement,
+                               htu21_real_t *values, enum htu21_status *status)
+{
+    int64_t done_us = 0, wait_us;
+    uint32_t first, i;
+
+    // Batches are per bus : consecutive devices of the same bus go together
+    for (first = 0; first < count; first = i) {
+        for (i = first + 1; i < count && devices[i]->bus == devices[first]->bus; i++)
+            ;
+        htu21_dev_start_conversions(&devices[first], i - first, measurement, &status[first]);
+    }
+    for (i = 0; i < count; i++)
+        if (status[i] == htu21_status_ok && devices[i]->conversion_done_us > done_us)
+            done_us = devices[i]->conversion_done_us;
+
+    wait_us = done_us - esp_timer_get_time();
+    if (wait_us > 0)
+        htu21_wait_us((uint32_t) wait_us);
+
+    for (first = 0; first < count; first = i) {
+        for (i = first + 1; i < count && devices[i]->bus == devices[first]->bus; i++)
+            ;
+        htu21_dev_fetch_conversions(&devices[first], i - first, measurement, &values[first], &status[first]);
+    }
+}
+
+/**
+ * \brief Measures temperature and humidity on several devices, with the
+ *        conversions of each kind run together (see htu21_dev_run_conversions).
+ *        Devices with HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY (Si70xx) skip
+ *        the temperature conversion : their temperature is read back after
+ *        the humidity conversion. Devices whose status is not
+ *        htu21_status_ok on entry are skipped.
  *
- * \return float - Dew point temperature (DegC).
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[out] htu21_real_t* : Temperature of each device (degC)
+ * \param[out] htu21_real_t* : Relative humidity of each device (%RH)
+ * \param[in,out] htu21_status* : Status of each device
  */
-float htu21_compute_dew_point(float temperature,float relative_humidity)
+void htu21_dev_run_measurements(struct htu21_device **devices, uint32_t count, htu21_real_t *temperature,
+                                htu21_real_t *humidity, enum htu21_status *status)
 {
-    double partial_pressure;
-    double dew_point;
+    enum htu21_status temperature_status[HTU21_MEASUREMENT_CHUNK];
+    uint32_t first, i;
+
+    for (first = 0; first < count; first += HTU21_MEASUREMENT_CHUNK) {
+        uint32_t chunk = (count - first > HTU21_MEASUREMENT_CHUNK) ? HTU21_MEASUREMENT_CHUNK : count - first;
+
+        // Only the devices without temperature from humidity convert the temperature
+        for (i = 0; i < chunk; i++)
+            temperature_status[i] = htu21_family_has(htu21_dev_family(devices[first + i]),
+                                                     HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY)
+                                    ? htu21_status_i2c_transfer_error : status[first + i];
+        htu21_dev_run_conversions(&devices[first], chunk, htu21_measurement_temperature, &temperature[first],
+                                  temperature_status);
+        for (i = 0; i < chunk; i++)
+            if (!htu21_family_has(htu21_dev_family(devices[first + i]), HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY))
+                status[first + i] = temperature_status[i];
+
+        htu21_dev_run_conversions(&devices[first], chunk, htu21_measurement_relative_humidity, &humidity[first],
+                                  &status[first]);
+
+        for (i = first; i < first + chunk; i++) {
+            struct htu21_device *dev = devices[i];
+            const struct htu21_family *family = htu21_dev_family(dev);
+            struct htu21_thermal_model *model;
+            uint16_t adc;
+
+            if (status[i] != htu21_status_ok
+                || !htu21_family_has(family, HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY))
+                continue;
+
+            htu21_dev_acquire(dev);
+            status[i] = htu21_previous_temperature_read_adc(dev, family, &adc);
+            if (status[i] == htu21_status_ok) {
+                model = __atomic_load_n(&dev->thermal_model, __ATOMIC_ACQUIRE);
+                temperature[i] = htu21_dev_convert_temperature(dev, htu21_config_resolution(htu21_config_load(dev)),
+                                                               adc);
+                if (model != NULL)
+                    temperature[i] = HTU21_REAL_FROM_FLOAT(htu21_thermal_correct_temperature(
+                        model, dev->conversion_done_us, HTU21_REAL_TO_FLOAT(temperature[i])));
+            }
+            htu21_dev_release(dev);
+        }
+    }
+}
 
-    // Missing power of 10
-    partial_pressure = pow(10, HTU21_CONSTANT_A - HTU21_CONSTANT_B / (temperature + HTU21_CONSTANT_C));
+/**
+ * \brief Submits the batch of devices[from, to) and, when it fails, serves
+ *        these devices one by one so that only the failing ones report an
+ *        error. Bus lock held.
+ */
+static void htu21_fleet_flush(struct htu21_device **devices, uint32_t from, uint32_t to,
+                              const struct htu21_fleet_exchange *exchange, enum htu21_status *status,
+                              const struct htu21_bus_batch *batch)
+{
+    uint16_t bytes = exchange->length + exchange->buffer_length + ((exchange->buffer != NULL) ? 2 : 1);
+    uint32_t i;
+
+    if (batch->count == 0
+        || htu21_dev_batch_submit(&devices[from], to - from, &status[from], batch, bytes) == ESP_OK)
+        return;
+
+    for (i = from; i < to; i++) {
+        if (status[i] != htu21_status_ok)
+            continue;
+        if (htu21_dev_transfer(devices[i], exchange->data + i * exchange->data_stride, exchange->length,
+                               (exchange->buffer != NULL) ? exchange->buffer + i * exchange->buffer_stride : NULL,
+                               exchange->buffer_length) != ESP_OK)
+            status[i] = htu21_status_i2c_transfer_error;
+    }
+}
 
-    dew_point = -HTU21_CONSTANT_B / (log10(relative_humidity * partial_pressure / 100) - HTU21_CONSTANT_A) -
-                HTU21_CONSTANT_C;
+/**
+ * \brief Runs the same exchange with every device whose status is ok. The
+ *        consecutive devices of one bus go in batches as full as they can be,
+ *        their mux selects included.
+ */
+static void htu21_fleet_run(struct htu21_device **devices, uint32_t count,
+                            const struct htu21_fleet_exchange *exchange, enum htu21_status *status)
+{
+    struct htu21_bus_batch batch;
+    uint32_t first = 0, from, i;
+
+    while (first < count) {
+        struct htu21_bus *bus = devices[first]->bus;
+
+        htu21_bus_lock(bus);
+        htu21_bus_batch_init(&batch);
+        for (from = i = first; i < count && devices[i]->bus == bus; i++) {
+            uint32_t needed = ((devices[i]->mux != NULL) ? 1 : 0) + ((exchange->buffer != NULL) ? 2 : 1);
+
+            if (status[i] != htu21_status_ok)
+                continue;
+            if (batch.count + needed > HTU21_BUS_BATCH_MAX_TRANSFERS) {
+                htu21_fleet_flush(devices, from, i, exchange, status, &batch);
+                htu21_bus_batch_init(&batch);
+                from = i;
+            }
+
+            htu21_dev_batch_select(devices[i], &batch);
+            htu21_bus_batch_write(&batch, devices[i]->address, exchange->data + i * exchange->data_stride,
+                                  exchange->length);
+            if (exchange->buffer != NULL)
+                htu21_bus_batch_read(&batch, devices[i]->address, exchange->buffer + i * exchange->buffer_stride,
+                                     exchange->buffer_length);
+        }
+        htu21_fleet_flush(devices, from, i, exchange, status, &batch);
+        htu21_bus_unlock(bus);
+
+        first = i;
+    }
+}
 
-    return (float) dew_point;
+/**
+ * \brief Initializes a fleet of devices at boot : resets them all, waits once
+ *        for the reset, then sets their resolution and reads their serial
+ *        numbers, which set their family. The devices of one bus are served in batches, across their
+ *        mux channels. The devices must not be in use by other tasks.
+ *
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_resolution : Resolution to set
+ * \param[out] htu21_fleet_result* : Result of each device
+ */
+void htu21_fleet_init(struct htu21_device **devices, uint32_t count, enum htu21_resolution resolution,
+                      struct htu21_fleet_result *results)
+{
+    static const uint8_t reset_cmd = HTU21_RESET_COMMAND;
+    static const uint8_t read_user_reg_cmd = HTU21_READ_USER_REG_COMMAND;
+    static const uint8_t serial_first_cmd[2] = {
+        (HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND >> 8) & 0xFF, HTU21_READ_SERIAL_FIRST_8BYTES_COMMAND & 0xFF
+    };
+    static const uint8_t serial_last_cmd[2] = {
+        (HTU21_READ_SERIAL_LAST_6BYTES_COMMAND >> 8) & 0xFF, HTU21_READ_SERIAL_LAST_6BYTES_COMMAND & 0xFF
+    };
+    enum htu21_status status[HTU21_FLEET_CHUNK];
+    uint8_t user_reg[HTU21_FLEET_CHUNK];
+    uint8_t write_user_reg[HTU21_FLEET_CHUNK][2];
+    uint8_t serial[HTU21_FLEET_CHUNK][14];
+    struct htu21_fleet_exchange exchange;
+    uint32_t first, n, i;
+
+    resolution &= HTU21_CONFIG_RESOLUTION_MASK;
+
+    // Every reset first, then one wait for all of them
+    exchange = (struct htu21_fleet_exchange) { .data = &reset_cmd, .length = 1 };
+    for (first = 0; first < count; first += n) {
+        n = (count - first > HTU21_FLEET_CHUNK) ? HTU21_FLEET_CHUNK : count - first;
+        for (i = 0; i < n; i++)
+            status[i] = htu21_status_ok;
+
+        htu21_fleet_run(&devices[first], n, &exchange, status);
+        for (i = 0; i < n; i++) {
+            results[first + i].status = status[i];
+            results[first + i].serial_number = 0;
+            htu21_config_update(devices[first + i], HTU21_CONFIG_RESOLUTION_MASK, htu21_resolution_t_14b_rh_12b);
+        }
+    }
+    htu21_wait_us(RESET_TIME * 1000);
+
+    for (first = 0; first < count; first += n) {
+        n = (count - first > HTU21_FLEET_CHUNK) ? HTU21_FLEET_CHUNK : count - first;
+        for (i = 0; i < n; i++)
+            status[i] = results[first + i].status;
+
+        // Resolution : read-modify-write of the user register
+        exchange = (struct htu21_fleet_exchange) {
+            .data = &read_user_reg_cmd, .length = 1,
+            .buffer = user_reg, .buffer_stride = 1, .buffer_length = 1,
+        };
+        htu21_fleet_run(&devices[first], n, &exchange, status);
+        for (i = 0; i < n; i++) {
+            write_user_reg[i][0] = HTU21_WRITE_USER_REG_COMMAND;
+            write_user_reg[i][1] = (user_reg[i] & ~HTU21_USER_REG_RESOLUTION_MASK)
+                                   | (htu21_user_reg_resolution[resolution] & HTU21_USER_REG_RESOLUTION_MASK);
+        }
+        exchange = (struct htu21_fleet_exchange) { .data = write_user_reg[0], .data_stride = 2, .length = 2 };
+        htu21_fleet_run(&devices[first], n, &exchange, status);
+        for (i = 0; i < n; i++)
+            if (status[i] == htu21_status_ok)
+                htu21_config_update(devices[first + i], HTU21_CONFIG_RESOLUTION_MASK, resolution);
+
+        // Serial number, in two reads
+        exchange = (struct htu21_fleet_exchange) {
+            .data = serial_first_cmd, .length = 2,
+            .buffer = serial[0], .buffer_stride = 14, .buffer_length = 8,
+        };
+        htu21_fleet_run(&devices[first], n, &exchange, status);
+        exchange = (struct htu21_fleet_exchange) {
+            .data = serial_last_cmd, .length = 2,
+            .buffer = &serial[0][8], .buffer_stride = 14, .buffer_length = 6,
+        };
+        htu21_fleet_run(&devices[first], n, &exchange, status);
+
+        for (i = 0; i < n; i++) {
+            if (status[i] == htu21_status_ok)
+                status[i] = htu21_serial_number_decode(serial[i], &results[first + i].serial_number);
+            if (status[i] == htu21_status_ok)
+                __atomic_store_n(&devices[first + i]->family, htu21_family_detect(results[first + i].serial_number),
+                                 __ATOMIC_RELEASE);
+            results[first + i].status = status[i];
+        }
+    }
+}
+
+/**
+ * \brief Returns the time needed by one temperature and humidity measurement
+ *        at the current resolution.
+ *
+ * \return uint32_t - Conversion time (us).
+ */
+uint32_t htu21_get_measurement_time(void)
+{
+    return htu21_dev_get_measurement_time(&htu21_default_device);
+}
+
+/**
+ * \brief Returns the time needed by one measurement of the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Conversion time (us).
+ */
+uint32_t htu21_dev_get_measurement_time(const struct htu21_device *dev)
+{
+    return htu21_family_measurement_time(htu21_dev_family(dev), htu21_config_resolution(htu21_config_load(dev)));
+}
+
+/**
+ * \brief Attach a duty-cycle governor to the device.
+ *        When attached, htu21_read_temperature_and_relative_humidity waits until
+ *        the governor allows the next conversion. NULL detaches it.
+ *
+ * \param[in] htu21_governor* : Governor (see htu21d_governor.h)
+ */
+void htu21_set_governor(struct htu21_governor *governor)
+{
+    htu21_dev_set_governor(&htu21_default_device, governor);
+}
+
+/**
+ * \brief Attach a duty-cycle governor to the device. NULL detaches it.
+ *        The governor is updated under the bus lock of the device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_governor* : Governor (see htu21d_governor.h)
+ */
+void htu21_dev_set_governor(struct htu21_device *dev, struct htu21_governor *governor)
+{
+    __atomic_store_n(&dev->governor, governor, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Attach a self-heating thermal model to the device.
+ *        When attached, the temperature returned by
+ *        htu21_read_temperature_and_relative_humidity is corrected by the
+ *        estimated self-heating offset. The heater state is read from the
+ *        device and then tracked by htu21_enable_heater/htu21_disable_heater.
+ *        NULL detaches it.
+ *
+ * \param[in] htu21_thermal_model* : Model (see htu21d_thermal.h)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_set_thermal_model(struct htu21_thermal_model *model)
+{
+    return htu21_dev_set_thermal_model(&htu21_default_device, model);
+}
+
+/**
+ * \brief Attach a self-heating thermal model to the device. NULL detaches it.
+ *        The heater state is read and the model attached in one bus critical
+ *        section, so no heater change can be missed in between.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_thermal_model* : Model (see htu21d_thermal.h)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_dev_set_thermal_model(struct htu21_device *dev, struct htu21_thermal_model *model)
+{
+    enum htu21_status status = htu21_status_ok;
+    uint8_t reg_value;
+
+    htu21_dev_acquire(dev);
+    if (model != NULL) {
+        status = htu21_read_user_register(dev, &reg_value);
+        if (status == htu21_status_ok)
+            htu21_thermal_set_heater(model, esp_timer_get_time(),
+                                     (reg_value & HTU21_USER_REG_ONCHIP_HEATER_ENABLE) ? htu21_heater_on
+                                                                                       : htu21_heater_off);
+    }
+    if (status == htu21_status_ok)
+        __atomic_store_n(&dev->thermal_model, model, __ATOMIC_RELEASE);
+    htu21_dev_release(dev);
+
+    return status;
 }
 
 #ifdef __cplusplus
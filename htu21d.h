@@ -14,6 +14,8 @@
 #include <stdbool.h>
 #include <math.h>
 #include "esp32_i2c_utils.h"
+#include "htu21d_numeric.h"
+#include "htu21d_bus.h"
 
 // Enums
 enum htu21_i2c_master_mode {
@@ -45,6 +47,11 @@ enum htu21_heater_status {
 	htu21_heater_on
 };
 
+enum htu21_measurement {
+	htu21_measurement_temperature,
+	htu21_measurement_relative_humidity
+};
+
 enum i2c_transfer_direction {
     I2C_TRANSFER_WRITE = 0,
     I2C_TRANSFER_READ = 1,
@@ -56,6 +63,8 @@ enum status_code {
     STATUS_ERR_TIMEOUT = 0x02,
 };
 
+#include "htu21d_compute.h"
+
 struct i2c_master_packet {
     // Address to slave device
     uint16_t address;
@@ -65,10 +74,83 @@ struct i2c_master_packet {
     uint8_t *data;
 };
 
+struct htu21_governor;
+struct htu21_thermal_model;
+struct htu21_request;
+struct htu21_metrics;
+struct htu21_mux;
+struct htu21_family;
+struct htu21_calibration;
+
+// HTU21 default I2C address
+#define HTU21_DEFAULT_ADDRESS                                0x40
+
+// Outcome of htu21_fleet_init for one device
+struct htu21_fleet_result {
+    enum htu21_status status;
+    uint64_t serial_number;
+};
+
+// ADC code conversion of one device, with its calibration folded in
+struct htu21_conversion {
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+    // value (0.01 degC or %RH) = ((code * mul + 0x8000) >> 16) + add
+    int32_t temperature_mul;
+    int32_t temperature_add;
+    int32_t humidity_mul;
+    int32_t humidity_add;
+#else
+    // value = code * mul + add
+    htu21_real_t temperature_mul;
+    htu21_real_t temperature_add;
+    htu21_real_t humidity_mul;
+    htu21_real_t humidity_add;
+#endif
+};
+
+// One HTU21 device. Several devices may share one bus.
+struct htu21_device {
+    struct htu21_bus *bus;
+    uint8_t address;
+    // Resolution and master mode, read and written atomically
+    uint32_t config;
+    // Optional attachments, see htu21_dev_set_governor / htu21_dev_set_thermal_model
+    struct htu21_governor *governor;
+    struct htu21_thermal_model *thermal_model;
+    // Measurement in progress and end of its current conversion (us), under the bus lock
+    bool measuring;
+    int64_t conversion_done_us;
+    // Bus reservation of a started conversion, -1 when none
+    int reservation;
+    // Pending requests of htu21d_queue.h, accessed atomically
+    struct htu21_request *waiters;
+    // Optional counters (see htu21d_metrics.h)
+    struct htu21_metrics *metrics;
+    // SCL clock of the transfers with the device (Hz), 0 : bus left as it is
+    uint32_t scl_hz;
+    // Mux channel of the device, mux NULL when directly on the bus
+    struct htu21_mux *mux;
+    uint8_t channel;
+    // Conversion timings and command extensions (see htu21d_family.h), accessed atomically
+    const struct htu21_family *family;
+    // Calibrated conversion, under the bus lock. Datasheet conversion when not calibrated.
+    bool calibrated;
+    struct htu21_conversion conversion;
+};
+
 void i2c_master_init(void);
 
 //void delay_ms(int ms);
 
+/**
+ * \brief Blocks the calling task for at least the given time, rounded up to
+ *        whole ticks plus one, since a tick delay can end up to one tick
+ *        early. Returns at once for 0.
+ *
+ * \param[in] uint32_t : Time (us)
+ */
+void htu21_wait_us(uint32_t);
+
 // Functions
 
 /**
@@ -133,8 +215,8 @@ void htu21_set_i2c_master_mode(enum htu21_i2c_master_mode);
 /**
  * \brief Reads the relative humidity value.
  *
- * \param[out] float* : Celsius Degree temperature value
- * \param[out] float* : %RH Relative Humidity value
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
  *
  * \return htu21_status : status of HTU21
  *       - htu21_status_ok : I2C transfer completed successfully
@@ -142,7 +224,7 @@ void htu21_set_i2c_master_mode(enum htu21_i2c_master_mode);
  *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
  *       - htu21_status_crc_error : CRC check error
  */
-enum htu21_status htu21_read_temperature_and_relative_humidity( float *, float*);
+enum htu21_status htu21_read_temperature_and_relative_humidity( htu21_real_t *, htu21_real_t*);
 
 /**
  * \brief Provide battery status
@@ -193,23 +275,402 @@ enum htu21_status htu21_disable_heater(void);
 enum htu21_status htu21_get_heater_status(enum htu21_heater_status*);
 
 /**
- * \brief Returns result of compensated humidity
+ * \brief Returns the time needed by one temperature and humidity measurement
+ *        at the current resolution.
+ *
+ * \return uint32_t - Conversion time (us).
+ */
+uint32_t htu21_get_measurement_time(void);
+
+/**
+ * \brief Attach a duty-cycle governor to the device.
+ *        When attached, htu21_read_temperature_and_relative_humidity waits until
+ *        the governor allows the next conversion. NULL detaches it.
+ *
+ * \param[in] htu21_governor* : Governor (see htu21d_governor.h)
+ */
+void htu21_set_governor(struct htu21_governor *);
+
+/**
+ * \brief Attach a self-heating thermal model to the device.
+ *        When attached, the temperature returned by
+ *        htu21_read_temperature_and_relative_humidity is corrected by the
+ *        estimated self-heating offset, so the compensated humidity computed
+ *        from it uses the corrected temperature. NULL detaches it.
+ *
+ * \param[in] htu21_thermal_model* : Model (see htu21d_thermal.h)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_set_thermal_model(struct htu21_thermal_model *);
+
+// Device functions
+// Same as the functions above, on a given device. The functions above act on
+// the default device : address HTU21_DEFAULT_ADDRESS on the esp32_i2c_utils
+// bus. Transfers are serialized per bus, the configuration is published
+// atomically, so a device may be used from several tasks.
+
+/**
+ * \brief Initializes a device. Resolution T 14b / RH 12b, no hold master mode.
+ *
+ * \param[out] htu21_device* : Device to initialize
+ * \param[in] htu21_bus* : Bus the device is attached to (see htu21d_bus.h)
+ * \param[in] uint8_t : I2C address
+ */
+void htu21_dev_init(struct htu21_device *, struct htu21_bus *, uint8_t);
+
+/**
+ * \brief Returns the device used by the functions without device argument.
+ *
+ * \return htu21_device* - Default device.
+ */
+struct htu21_device *htu21_get_default_device(void);
+
+/**
+ * \brief Check whether the device is connected
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return bool : status of HTU21
+ *       - true : Device is present
+ *       - false : Device is not acknowledging I2C address
+ */
+bool htu21_dev_is_connected(struct htu21_device *);
+
+/**
+ * \brief Reset the device
  *
- * \param[in] float - Actual temperature measured (degC)
- * \param[in] float - Actual relative humidity measured (%RH)
+ * \param[in] htu21_device* : Device
  *
- * \return float - Compensated humidity (%RH).
+ * \return htu21_status : status of HTU21
  */
-float htu21_compute_compensated_humidity(float,float);
+enum htu21_status htu21_dev_reset(struct htu21_device *);
 
 /**
- * \brief Returns the computed dew point
+ * \brief Reads the serial number of the device, and sets its family from it
+ *        (see htu21d_family.h).
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] uint64_t* : Serial number
  *
- * \param[in] float - Actual temperature measured (degC)
- * \param[in] float - Actual relative humidity measured (%RH)
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_read_serial_number(struct htu21_device *, uint64_t *);
+
+/**
+ * \brief Probes the device and reads its serial number without waiting for
+ *        the bus : skipped when the bus is taken, the device is measuring, or
+ *        a conversion reserved on the bus ends within the time of the probe.
+ *        Sets the family of the device from the serial number.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : Bus time of the probe (us)
+ * \param[out] uint64_t* : Serial number
+ * \param[out] htu21_status* : Status of the probe
+ *       - htu21_status_ok : Serial number read
+ *       - htu21_status_no_i2c_acknowledge : Device not answering
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_crc_error : CRC check error
+ *
+ * \return bool : false when the probe was skipped
+ */
+bool htu21_dev_try_identify(struct htu21_device *, uint32_t, uint64_t *, enum htu21_status *);
+
+/**
+ * \brief Set temperature and humidity ADC resolution of the device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_resolution : Resolution requested
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_set_resolution(struct htu21_device *, enum htu21_resolution);
+
+/**
+ * \brief Returns the resolution last set on the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_resolution - Resolution.
+ */
+enum htu21_resolution htu21_dev_get_resolution(const struct htu21_device *);
+
+/**
+ * \brief Set I2C master mode of the device. A device with a speed profile
+ *        whose bus cannot stretch the clock for a whole conversion (e.g. the
+ *        ESP32, about 13 ms) is measured in no hold master mode.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_i2c_master_mode : I2C mode
+ */
+void htu21_dev_set_i2c_master_mode(struct htu21_device *, enum htu21_i2c_master_mode);
+
+/**
+ * \brief Reads the temperature and relative humidity of the device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_read_temperature_and_relative_humidity(struct htu21_device *, htu21_real_t *,
+                                                                   htu21_real_t *);
+
+/**
+ * \brief Provide battery status of the device
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_battery_status* : Battery status
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_get_battery_status(struct htu21_device *, enum htu21_battery_status *);
+
+/**
+ * \brief Enable heater of the device
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_enable_heater(struct htu21_device *);
+
+/**
+ * \brief Disable heater of the device
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_disable_heater(struct htu21_device *);
+
+/**
+ * \brief Get heater status of the device
+ *
+ * \param[in] htu21_device* : Device
+ * \param[out] htu21_heater_status* : Heater status
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_get_heater_status(struct htu21_device *, enum htu21_heater_status *);
+
+/**
+ * \brief Returns the time needed by one measurement of the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Conversion time (us).
+ */
+uint32_t htu21_dev_get_measurement_time(const struct htu21_device *);
+
+/**
+ * \brief Attach a duty-cycle governor to the device. NULL detaches it.
+ *        A governor belongs to one device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_governor* : Governor (see htu21d_governor.h)
+ */
+void htu21_dev_set_governor(struct htu21_device *, struct htu21_governor *);
+
+/**
+ * \brief Attach a self-heating thermal model to the device. NULL detaches it.
+ *        A model belongs to one device.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_thermal_model* : Model (see htu21d_thermal.h)
+ *
+ * \return htu21_status : status of HTU21
+ */
+enum htu21_status htu21_dev_set_thermal_model(struct htu21_device *, struct htu21_thermal_model *);
+
+/**
+ * \brief Attach a metrics block to the device. NULL detaches it.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_metrics* : Metrics (see htu21d_metrics.h)
+ */
+void htu21_dev_set_metrics(struct htu21_device *, struct htu21_metrics *);
+
+/**
+ * \brief Puts the device behind a channel of a mux on its bus. To be called
+ *        before the device is used.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_mux* : Mux, NULL for a device directly on the bus
+ * \param[in] uint8_t : Channel
+ */
+void htu21_dev_set_mux(struct htu21_device *, struct htu21_mux *, uint8_t);
+
+/**
+ * \brief Sets the family of the device, for parts whose electronic ID is not
+ *        recognized by htu21_dev_read_serial_number.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_family* : Family (see htu21d_family.h)
+ */
+void htu21_dev_set_family(struct htu21_device *, const struct htu21_family *);
+
+/**
+ * \brief Returns the family of the device.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return htu21_family* - Family (see htu21d_family.h).
+ */
+const struct htu21_family *htu21_dev_get_family(const struct htu21_device *);
+
+/**
+ * \brief Sets the calibration of the device : folds its gains and offsets
+ *        into the conversion coefficients of the device, so that calibrated
+ *        values cost no more than raw ones. NULL restores the datasheet
+ *        conversion.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_calibration* : Calibration (see htu21d_calibration.h)
+ */
+void htu21_dev_set_calibration(struct htu21_device *, const struct htu21_calibration *);
+
+/**
+ * \brief Sets the SCL clock the bus runs at for the transfers with the device.
+ *        The clock-stretch timeout follows the resolution and master mode.
+ *        Applied when the bus switches to the device, e.g. behind a mux on a
+ *        long cable.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] uint32_t : SCL clock (Hz), 0 to leave the bus as it is
+ */
+void htu21_dev_set_speed(struct htu21_device *, uint32_t);
+
+/**
+ * \brief Returns the timeout of each transport operation with the device : a
+ *        transfer budget, plus the slowest conversion of the resolution in
+ *        hold master mode, where the device stretches the clock.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Timeout (us).
+ */
+uint32_t htu21_dev_get_transfer_timeout(struct htu21_device *);
+
+/**
+ * \brief Returns how long the governor of the device delays the next trigger.
+ *
+ * \param[in] htu21_device* : Device
+ *
+ * \return uint32_t - Delay (us), 0 without governor.
+ */
+uint32_t htu21_dev_get_trigger_delay(struct htu21_device *);
+
+/**
+ * \brief Triggers one conversion in no hold master mode and returns at once.
+ *        The bus is released and reserved until the end of the conversion,
+ *        given by conversion_done_us of the device. Other operations on the
+ *        device wait until htu21_dev_fetch_conversion. Triggering the
+ *        temperature accounts the whole measurement in the governor and the
+ *        thermal model.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_measurement : Conversion to start
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ */
+enum htu21_status htu21_dev_start_conversion(struct htu21_device *, enum htu21_measurement);
+
+/**
+ * \brief Reads the result of the conversion started by
+ *        htu21_dev_start_conversion, not before conversion_done_us.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_measurement : Conversion started
+ * \param[out] htu21_real_t* : Temperature (degC) or relative humidity (%RH)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer, or no
+ *                                           conversion started
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_dev_fetch_conversion(struct htu21_device *, enum htu21_measurement, htu21_real_t *);
+
+/**
+ * \brief Starts the same conversion on several devices of one bus, with the
+ *        triggers sent in one batch. When the batch fails, the triggers are
+ *        sent one by one so that only the failing devices report an error.
+ *        Devices whose status is not htu21_status_ok on entry are skipped.
+ *
+ * \param[in] htu21_device** : Devices, all on the same bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion to start
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_start_conversions(struct htu21_device **, uint32_t, enum htu21_measurement, enum htu21_status *);
+
+/**
+ * \brief Reads the results of conversions started by
+ *        htu21_dev_start_conversions, with the reads sent in one batch. When
+ *        the batch fails, the results are read one by one. Devices whose
+ *        status is not htu21_status_ok on entry are skipped.
+ *
+ * \param[in] htu21_device** : Devices, all on the same bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion started
+ * \param[out] htu21_real_t* : Value of each device
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_fetch_conversions(struct htu21_device **, uint32_t, enum htu21_measurement, htu21_real_t *,
+                                 enum htu21_status *);
+
+/**
+ * \brief Runs one conversion on several devices : triggers them in one batch
+ *        per bus, waits once for the slowest, fetches them in one batch per
+ *        bus. The devices take about the wall time of one. Devices whose
+ *        status is not htu21_status_ok on entry are skipped.
+ *
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_measurement : Conversion to run
+ * \param[out] htu21_real_t* : Value of each device
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_run_conversions(struct htu21_device **, uint32_t, enum htu21_measurement, htu21_real_t *,
+                               enum htu21_status *);
+
+/**
+ * \brief Measures temperature and humidity on several devices, with the
+ *        conversions of each kind run together (see htu21_dev_run_conversions).
+ *        Devices with HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY (Si70xx) skip
+ *        the temperature conversion : their temperature is read back after
+ *        the humidity conversion. Devices whose status is not
+ *        htu21_status_ok on entry are skipped.
+ *
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[out] htu21_real_t* : Temperature of each device (degC)
+ * \param[out] htu21_real_t* : Relative humidity of each device (%RH)
+ * \param[in,out] htu21_status* : Status of each device
+ */
+void htu21_dev_run_measurements(struct htu21_device **, uint32_t, htu21_real_t *, htu21_real_t *,
+                                enum htu21_status *);
+
+// Fleet functions
+
+/**
+ * \brief Initializes a fleet of devices at boot : resets them all, waits once
+ *        for the reset, then sets their resolution and reads their serial
+ *        numbers, which set their family. The devices of one bus are served in batches, across their
+ *        mux channels. The devices must not be in use by other tasks.
  *
- * \return float - Dew point temperature (DegC).
+ * \param[in] htu21_device** : Devices, best grouped by bus
+ * \param[in] uint32_t : Number of devices
+ * \param[in] htu21_resolution : Resolution to set
+ * \param[out] htu21_fleet_result* : Result of each device
  */
-float htu21_compute_dew_point(float,float);
+void htu21_fleet_init(struct htu21_device **, uint32_t, enum htu21_resolution, struct htu21_fleet_result *);
 
 #endif /* HTU21_H_INCLUDED */
\ No newline at end of file
@@ -0,0 +1,582 @@
+/**
+ * \file htu21d_bus.c
+ *
+ * \brief HTU21 I2C bus source file
+ *
+ */
+
+#include "htu21d_bus.h"
+
+#ifdef ESP_PLATFORM
+#include "esp32_i2c_utils.h"
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "rom/ets_sys.h"
+#else
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ESP_PLATFORM
+
+// Port configured by esp32_i2c_utils
+#define HTU21_BUS_ESP32_PORT                                I2C_NUM_0
+// Clock-stretch timeout of the controller, in APB cycles : at most about 13 ms
+#define HTU21_BUS_ESP32_APB_MHZ                                80
+#define HTU21_BUS_ESP32_STRETCH_MAX_CYCLES                    0xFFFFF
+// Recovery : SCL half period (100 kHz) and clock pulses
+#define HTU21_BUS_RECOVERY_HALF_PERIOD_US                    5
+#define HTU21_BUS_RECOVERY_PULSES                            9
+
+static inline TickType_t htu21_bus_esp32_ticks(uint32_t timeout_us)
+{
+    TickType_t ticks = ((timeout_us + 999) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+
+    return (ticks != 0) ? ticks : 1;
+}
+
+static esp_err_t htu21_bus_esp32_transfer(void *context, const struct htu21_bus_transfer *transfers, uint32_t count,
+                                          uint32_t timeout_us)
+{
+    i2c_cmd_handle_t cmd;
+    esp_err_t err;
+    uint32_t i;
+
+    (void) context;
+
+    cmd = i2c_cmd_link_create();
+    if (cmd == NULL)
+        return ESP_ERR_NO_MEM;
+
+    for (i = 0; i < count; i++) {
+        const struct htu21_bus_transfer *transfer = &transfers[i];
+
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (transfer->address << 1) | (transfer->read ? I2C_MASTER_READ : I2C_MASTER_WRITE),
+                              true);
+        if (transfer->length != 0) {
+            if (transfer->read)
+                i2c_master_read(cmd, transfer->data, transfer->length, I2C_MASTER_LAST_NACK);
+            else
+                i2c_master_write(cmd, transfer->data, transfer->length, true);
+        }
+        if (transfer->stop && i + 1 < count)
+            i2c_master_stop(cmd);
+    }
+    i2c_master_stop(cmd);
+
+    err = i2c_master_cmd_begin(HTU21_BUS_ESP32_PORT, cmd, htu21_bus_esp32_ticks(timeout_us));
+    i2c_cmd_link_delete(cmd);
+
+    return err;
+}
+
+static esp_err_t htu21_bus_esp32_write(void *context, uint8_t address, const uint8_t *data, uint16_t length,
+                                       uint32_t timeout_us)
+{
+    struct htu21_bus_transfer transfer = {
+        .address = address,
+        .read    = false,
+        .length  = length,
+        .data    = (uint8_t *) data,
+    };
+
+    return htu21_bus_esp32_transfer(context, &transfer, 1, timeout_us);
+}
+
+static esp_err_t htu21_bus_esp32_read(void *context, uint8_t address, uint8_t *data, uint16_t length,
+                                      uint32_t timeout_us)
+{
+    struct htu21_bus_transfer transfer = {
+        .address = address,
+        .read    = true,
+        .length  = length,
+        .data    = data,
+    };
+
+    return htu21_bus_esp32_transfer(context, &transfer, 1, timeout_us);
+}
+
+static esp_err_t htu21_bus_esp32_write_read(void *context, uint8_t address, const uint8_t *data, uint16_t length,
+                                            uint8_t *buffer, uint16_t buffer_length, uint32_t timeout_us)
+{
+    struct htu21_bus_transfer transfers[2] = {
+        {
+            .address = address,
+            .read    = false,
+            .length  = length,
+            .data    = (uint8_t *) data,
+        },
+        {
+            .address = address,
+            .read    = true,
+            .length  = buffer_length,
+            .data    = buffer,
+        },
+    };
+
+    return htu21_bus_esp32_transfer(context, transfers, 2, timeout_us);
+}
+
+static esp_err_t htu21_bus_esp32_set_speed(void *context, uint32_t scl_hz, uint32_t stretch_timeout_us)
+{
+    i2c_config_t *cfg = get_i2c_num_0_cfg();
+    uint64_t cycles = (uint64_t) stretch_timeout_us * HTU21_BUS_ESP32_APB_MHZ;
+    esp_err_t err = ESP_OK;
+
+    (void) context;
+
+    if (cfg == NULL)
+        return ESP_FAIL;
+    // Beyond the timeout register, the controller would abort a longer stretch
+    if (cycles > HTU21_BUS_ESP32_STRETCH_MAX_CYCLES)
+        return ESP_ERR_INVALID_ARG;
+
+    if (cfg->master.clk_speed != scl_hz) {
+        cfg->master.clk_speed = scl_hz;
+        err = i2c_param_config(HTU21_BUS_ESP32_PORT, cfg);
+    }
+    if (err == ESP_OK)
+        err = i2c_set_timeout(HTU21_BUS_ESP32_PORT, (int) cycles);
+
+    return err;
+}
+
+static enum htu21_bus_recovery htu21_bus_esp32_recover(void *context)
+{
+    i2c_config_t *cfg = get_i2c_num_0_cfg();
+    gpio_num_t sda, scl;
+    bool stuck;
+    int i;
+
+    (void) context;
+
+    if (cfg == NULL)
+        return htu21_bus_not_stuck;
+    sda = cfg->sda_io_num;
+    scl = cfg->scl_io_num;
+
+    // Take the lines from the controller, released high
+    gpio_set_level(scl, 1);
+    gpio_set_level(sda, 1);
+    gpio_set_direction(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+
+    stuck = !gpio_get_level(sda) || !gpio_get_level(scl);
+    if (stuck) {
+        // Clock the device out of its byte until it releases SDA
+        for (i = 0; i < HTU21_BUS_RECOVERY_PULSES && !gpio_get_level(sda); i++) {
+            gpio_set_level(scl, 0);
+            ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+            gpio_set_level(scl, 1);
+            ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+        }
+
+        // STOP : SDA rises while SCL is high
+        gpio_set_level(scl, 0);
+        gpio_set_level(sda, 0);
+        ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(scl, 1);
+        ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(sda, 1);
+        ets_delay_us(HTU21_BUS_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // Give the lines back to the controller, with a clean state
+    i2c_set_pin(HTU21_BUS_ESP32_PORT, sda, scl, cfg->sda_pullup_en, cfg->scl_pullup_en, I2C_MODE_MASTER);
+    i2c_reset_tx_fifo(HTU21_BUS_ESP32_PORT);
+    i2c_reset_rx_fifo(HTU21_BUS_ESP32_PORT);
+
+    if (!stuck)
+        return htu21_bus_not_stuck;
+    return (gpio_get_level(sda) && gpio_get_level(scl)) ? htu21_bus_recovered : htu21_bus_still_stuck;
+}
+
+const struct htu21_bus_ops htu21_bus_esp32_ops = {
+    .write      = htu21_bus_esp32_write,
+    .read       = htu21_bus_esp32_read,
+    .write_read = htu21_bus_esp32_write_read,
+    .transfer   = htu21_bus_esp32_transfer,
+    .set_speed  = htu21_bus_esp32_set_speed,
+    .recover    = htu21_bus_esp32_recover,
+};
+
+static htu21_bus_lock_t htu21_bus_lock_create(void)
+{
+    return xSemaphoreCreateMutex();
+}
+
+static void htu21_bus_lock_delete(htu21_bus_lock_t lock)
+{
+    vSemaphoreDelete(lock);
+}
+
+static bool htu21_bus_lock_take(htu21_bus_lock_t lock, htu21_bus_timeout_t timeout, bool forever)
+{
+    return xSemaphoreTake(lock, forever ? portMAX_DELAY : timeout) == pdTRUE;
+}
+
+static void htu21_bus_lock_give(htu21_bus_lock_t lock)
+{
+    xSemaphoreGive(lock);
+}
+#else
+static htu21_bus_lock_t htu21_bus_lock_create(void)
+{
+    pthread_mutex_t *lock = malloc(sizeof(*lock));
+    pthread_mutexattr_t attr;
+
+    if (lock == NULL)
+        return NULL;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    if (pthread_mutex_init(lock, &attr) != 0) {
+        free(lock);
+        lock = NULL;
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    return lock;
+}
+
+static void htu21_bus_lock_delete(htu21_bus_lock_t lock)
+{
+    pthread_mutex_destroy(lock);
+    free(lock);
+}
+
+static bool htu21_bus_lock_take(htu21_bus_lock_t lock, htu21_bus_timeout_t timeout, bool forever)
+{
+    struct timespec deadline;
+
+    if (forever)
+        return pthread_mutex_lock(lock) == 0;
+    if (timeout == 0)
+        return pthread_mutex_trylock(lock) == 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (long) (timeout % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return pthread_mutex_timedlock(lock, &deadline) == 0;
+}
+
+static void htu21_bus_lock_give(htu21_bus_lock_t lock)
+{
+    pthread_mutex_unlock(lock);
+}
+#endif /* ESP_PLATFORM */
+
+/**
+ * \brief Initializes a bus and creates its lock, whatever the bus held
+ *        before. A bus initialized before is deinitialized first.
+ *
+ * \param[out] htu21_bus* : Bus to initialize
+ * \param[in] htu21_bus_ops* : Transport operations
+ * \param[in] void* : Context passed to the operations
+ *
+ * \return esp_err_t :
+ *       - ESP_OK : Bus ready
+ *       - ESP_ERR_NO_MEM : Lock could not be created
+ */
+esp_err_t htu21_bus_init(struct htu21_bus *bus, const struct htu21_bus_ops *ops, void *context)
+{
+    int i;
+
+    bus->ops = ops;
+    bus->context = context;
+    bus->lock = htu21_bus_lock_create();
+    for (i = 0; i < HTU21_BUS_MAX_RESERVATIONS; i++)
+        bus->reservations[i] = 0;
+    bus->overflowed = 0;
+    bus->scl_hz = 0;
+    bus->stretch_timeout_us = 0;
+
+    return (bus->lock != NULL) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * \brief Deletes the lock of a bus. No transfer may be in progress.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_deinit(struct htu21_bus *bus)
+{
+    if (bus->lock != NULL)
+        htu21_bus_lock_delete(bus->lock);
+    bus->lock = NULL;
+}
+
+/**
+ * \brief Takes the bus lock. Does nothing on a bus without lock.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_lock(struct htu21_bus *bus)
+{
+    if (bus->lock != NULL)
+        htu21_bus_lock_take(bus->lock, 0, true);
+}
+
+/**
+ * \brief Takes the bus lock, waiting at most the given time.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_bus_timeout_t : Timeout (ticks, ms outside ESP-IDF)
+ *
+ * \return bool : true when the lock was taken
+ */
+bool htu21_bus_try_lock(struct htu21_bus *bus, htu21_bus_timeout_t timeout)
+{
+    if (bus->lock == NULL)
+        return true;
+    return htu21_bus_lock_take(bus->lock, timeout, false);
+}
+
+/**
+ * \brief Gives the bus lock back.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_unlock(struct htu21_bus *bus)
+{
+    if (bus->lock != NULL)
+        htu21_bus_lock_give(bus->lock);
+}
+
+/**
+ * \brief Reserves the bus for the end of a conversion. Bus lock held.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int64_t : End of the conversion (us)
+ *
+ * \return int - Reservation slot, HTU21_BUS_RESERVATION_OVERFLOW when every
+ *         slot is in use.
+ */
+int htu21_bus_reserve(struct htu21_bus *bus, int64_t end_us)
+{
+    int i;
+
+    for (i = 0; i < HTU21_BUS_MAX_RESERVATIONS; i++) {
+        if (bus->reservations[i] == 0) {
+            bus->reservations[i] = end_us;
+            return i;
+        }
+    }
+
+    bus->overflowed++;
+    return HTU21_BUS_RESERVATION_OVERFLOW;
+}
+
+/**
+ * \brief Frees a reservation. Bus lock held.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int : Slot returned by htu21_bus_reserve
+ */
+void htu21_bus_release_reservation(struct htu21_bus *bus, int slot)
+{
+    if (slot >= 0 && slot < HTU21_BUS_MAX_RESERVATIONS)
+        bus->reservations[slot] = 0;
+    else if (slot == HTU21_BUS_RESERVATION_OVERFLOW && bus->overflowed != 0)
+        bus->overflowed--;
+}
+
+/**
+ * \brief Returns the time the bus stays free of HTU21 transfers. Bus lock
+ *        held, typically by another driver checking that its transfer fits.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Idle time (us), 0 when a conversion is already due or
+ *         a conversion found no free slot, HTU21_BUS_IDLE_FOREVER when
+ *         nothing is reserved.
+ */
+uint32_t htu21_bus_idle_time(const struct htu21_bus *bus, int64_t now_us)
+{
+    int64_t next_us = INT64_MAX;
+    int i;
+
+    // The end of an unslotted conversion is unknown : no idle window
+    if (bus->overflowed != 0)
+        return 0;
+
+    for (i = 0; i < HTU21_BUS_MAX_RESERVATIONS; i++)
+        if (bus->reservations[i] != 0 && bus->reservations[i] < next_us)
+            next_us = bus->reservations[i];
+
+    if (next_us == INT64_MAX)
+        return HTU21_BUS_IDLE_FOREVER;
+    if (next_us <= now_us)
+        return 0;
+    if (next_us - now_us >= HTU21_BUS_IDLE_FOREVER)
+        return HTU21_BUS_IDLE_FOREVER - 1;
+
+    return (uint32_t) (next_us - now_us);
+}
+
+/**
+ * \brief Switches the bus to a speed profile, bus lock held. Does nothing when
+ *        the profile is already applied or the transport cannot change it.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] uint32_t : SCL clock (Hz)
+ * \param[in] uint32_t : Clock-stretch timeout (us)
+ *
+ * \return esp_err_t :
+ *       - ESP_OK : Profile applied
+ *       - ESP_ERR_INVALID_ARG : Timeout above what the transport supports,
+ *         the bus is left as it is
+ *       - ESP_ERR_NOT_SUPPORTED : Transport without speed control
+ */
+esp_err_t htu21_bus_set_speed(struct htu21_bus *bus, uint32_t scl_hz, uint32_t stretch_timeout_us)
+{
+    esp_err_t err;
+
+    if (bus->ops->set_speed == NULL)
+        return ESP_ERR_NOT_SUPPORTED;
+    if (bus->scl_hz == scl_hz && bus->stretch_timeout_us == stretch_timeout_us)
+        return ESP_OK;
+
+    err = bus->ops->set_speed(bus->context, scl_hz, stretch_timeout_us);
+    if (err == ESP_OK) {
+        bus->scl_hz = scl_hz;
+        bus->stretch_timeout_us = stretch_timeout_us;
+    }
+
+    return err;
+}
+
+/**
+ * \brief Checks the lines of the bus after a failed transfer, bus lock held.
+ *        When a device holds them low, clocks it out of its transfer and
+ *        sends a STOP.
+ *
+ * \param[in] htu21_bus* : Bus
+ *
+ * \return htu21_bus_recovery : outcome
+ *       - htu21_bus_not_stuck : Lines free, or transport without recovery
+ *       - htu21_bus_recovered : Lines were stuck and are free again
+ *       - htu21_bus_still_stuck : Lines still held low
+ */
+enum htu21_bus_recovery htu21_bus_recover(struct htu21_bus *bus)
+{
+    if (bus->ops->recover == NULL)
+        return htu21_bus_not_stuck;
+    return bus->ops->recover(bus->context);
+}
+
+/**
+ * \brief Empties a batch.
+ *
+ * \param[out] htu21_bus_batch* : Batch
+ */
+void htu21_bus_batch_init(struct htu21_bus_batch *batch)
+{
+    batch->count = 0;
+}
+
+static bool htu21_bus_batch_add(struct htu21_bus_batch *batch, uint8_t address, bool read, uint8_t *data,
+                                uint16_t length)
+{
+    struct htu21_bus_transfer *transfer;
+
+    if (batch->count >= HTU21_BUS_BATCH_MAX_TRANSFERS)
+        return false;
+
+    transfer = &batch->transfers[batch->count++];
+    transfer->address = address;
+    transfer->read = read;
+    transfer->stop = false;
+    transfer->length = length;
+    transfer->data = data;
+    return true;
+}
+
+/**
+ * \brief Queues a write in a batch.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : I2C address
+ * \param[in] uint8_t* : Data, valid until the batch is submitted
+ * \param[in] uint16_t : Length
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_bus_batch_write(struct htu21_bus_batch *batch, uint8_t address, const uint8_t *data, uint16_t length)
+{
+    return htu21_bus_batch_add(batch, address, false, (uint8_t *) data, length);
+}
+
+/**
+ * \brief Queues a read in a batch.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : I2C address
+ * \param[out] uint8_t* : Buffer, filled when the batch is submitted
+ * \param[in] uint16_t : Length
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_bus_batch_read(struct htu21_bus_batch *batch, uint8_t address, uint8_t *data, uint16_t length)
+{
+    return htu21_bus_batch_add(batch, address, true, data, length);
+}
+
+/**
+ * \brief Ends the last transfer queued in a batch with a stop.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ */
+void htu21_bus_batch_stop(struct htu21_bus_batch *batch)
+{
+    if (batch->count != 0)
+        batch->transfers[batch->count - 1].stop = true;
+}
+
+/**
+ * \brief Runs a batch. Bus lock held. With a transport that supports batches
+ *        the whole batch fails when one transfer fails.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint32_t : Timeout of the batch (us)
+ *
+ * \return esp_err_t : ESP_OK when every transfer succeeded
+ */
+esp_err_t htu21_bus_batch_submit(struct htu21_bus *bus, const struct htu21_bus_batch *batch, uint32_t timeout_us)
+{
+    esp_err_t err = ESP_OK;
+    uint32_t i;
+
+    if (batch->count == 0)
+        return ESP_OK;
+    if (bus->ops->transfer != NULL)
+        return bus->ops->transfer(bus->context, batch->transfers, batch->count, timeout_us);
+
+    for (i = 0; i < batch->count && err == ESP_OK; i++) {
+        const struct htu21_bus_transfer *transfer = &batch->transfers[i];
+
+        if (transfer->read)
+            err = bus->ops->read(bus->context, transfer->address, transfer->data, transfer->length, timeout_us);
+        else
+            err = bus->ops->write(bus->context, transfer->address, transfer->data, transfer->length, timeout_us);
+    }
+
+    return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
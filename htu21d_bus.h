@@ -0,0 +1,336 @@
+/**
+ * \file htu21d_bus.h
+ *
+ * \brief HTU21 I2C bus header file
+ *
+ * One htu21_bus per physical I2C bus. Every HTU21 device attached to a bus
+ * serializes its transfers on the bus lock, so two tasks reading devices on
+ * different buses never wait on each other.
+ *
+ * The bus lock is a FreeRTOS mutex, with priority inheritance (a pthread
+ * mutex outside ESP-IDF), and is meant to be shared with the other drivers
+ * of the bus (RTC, EEPROM, ...). The HTU21
+ * driver holds it only for its transfers : in no hold master mode it
+ * releases the bus while a device converts, and reserves the end of the
+ * conversion. Another driver holding the bus reads the free time left
+ * before the next reservation with htu21_bus_idle_time, and fits its own
+ * transfers in it.
+ *
+ * The transport is given as a table of operations. htu21_bus_esp32_ops drives
+ * I2C_NUM_0, as configured by esp32_i2c_utils, with ESP-IDF command links.
+ * Devices on another bus need their own operations. htu21_bus_linux_ops
+ * drives a Linux i2c-dev adapter.
+ *
+ * Every operation takes a timeout : a misbehaving device fails its transfer
+ * within the budget the driver gives it, instead of stalling the caller for
+ * the platform timeout.
+ *
+ * Several transfers, possibly to different devices (mux select, trigger of
+ * one sensor, fetch of another), can be queued in a batch and submitted at
+ * once : one ESP-IDF command link, one Linux I2C_RDWR ioctl. The software
+ * cost of a transaction is then paid once per batch. Transports without
+ * batch support run the transfers one by one. A transfer flagged with
+ * htu21_bus_batch_stop ends with a STOP instead of a repeated start : a mux
+ * only switches its channel on the STOP (on Linux the ioctl is split there).
+ *
+ * Devices may run at different SCL clocks (400 kHz on the board, 100 kHz on
+ * a long cable). The bus remembers the clock and clock-stretch timeout last
+ * applied, and only reprograms the transport when the next device needs
+ * another profile. The ESP32 controller stretches the clock for at most
+ * 0xFFFFF APB cycles (about 13 ms) : a longer timeout is refused, and the
+ * HTU21 driver then measures in no hold master mode.
+ *
+ * A transfer interrupted in the middle of a read can leave a device holding
+ * SDA low, and every later transfer times out. After a transfer timed out,
+ * the driver asks the transport to check the lines and, when SDA or SCL is
+ * stuck low, to clock the device out of its read (up to 9 SCL pulses) and
+ * send a STOP. The transfer is then retried once. A NACK, e.g. of a device
+ * still converting, is not a stuck bus and is not recovered.
+ *
+ */
+
+#ifndef HTU21_BUS_H_INCLUDED
+#define HTU21_BUS_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Bus lock, and timeout of htu21_bus_try_lock (ticks)
+typedef SemaphoreHandle_t htu21_bus_lock_t;
+typedef TickType_t htu21_bus_timeout_t;
+#else
+#include <pthread.h>
+
+// Outside ESP-IDF (Linux i2c-dev) : the ESP-IDF error codes of the bus API
+#ifndef ESP_OK
+typedef int esp_err_t;
+#define ESP_OK                                                0
+#define ESP_FAIL                                            -1
+#define ESP_ERR_NO_MEM                                        0x101
+#define ESP_ERR_INVALID_ARG                                    0x102
+#define ESP_ERR_NOT_SUPPORTED                                0x106
+#define ESP_ERR_TIMEOUT                                        0x107
+#endif
+
+// Bus lock, a priority inheritance mutex, and timeout of htu21_bus_try_lock (ms)
+typedef pthread_mutex_t *htu21_bus_lock_t;
+typedef uint32_t htu21_bus_timeout_t;
+#endif
+
+// Number of conversions that can be reserved at once on one bus, one per
+// device of a measurement chunk. Conversions started with every slot in use
+// are counted apart, the bus then reports no idle time until they end.
+#ifndef HTU21_BUS_MAX_RESERVATIONS
+#define HTU21_BUS_MAX_RESERVATIONS                            16
+#endif
+
+// Reservation returned by htu21_bus_reserve when every slot is in use
+#define HTU21_BUS_RESERVATION_OVERFLOW                        HTU21_BUS_MAX_RESERVATIONS
+
+// Transfers per batch
+#ifndef HTU21_BUS_BATCH_MAX_TRANSFERS
+#define HTU21_BUS_BATCH_MAX_TRANSFERS                        8
+#endif
+
+// Idle time returned when no conversion is reserved
+#define HTU21_BUS_IDLE_FOREVER                                UINT32_MAX
+
+// Outcome of htu21_bus_recover
+enum htu21_bus_recovery {
+    htu21_bus_not_stuck,
+    htu21_bus_recovered,
+    htu21_bus_still_stuck
+};
+
+// One transfer of a batch, started with a (repeated) start
+struct htu21_bus_transfer {
+    uint8_t address;
+    bool read;
+    // Ends with a stop even inside a batch, e.g. a mux select that only
+    // takes effect on the stop
+    bool stop;
+    uint16_t length;
+    uint8_t *data;
+};
+
+struct htu21_bus_batch {
+    struct htu21_bus_transfer transfers[HTU21_BUS_BATCH_MAX_TRANSFERS];
+    uint32_t count;
+};
+
+// Every operation fails with ESP_ERR_TIMEOUT when it exceeds timeout_us
+struct htu21_bus_ops {
+    // Writes length bytes to the device, length 0 only addresses it
+    esp_err_t (*write)(void *context, uint8_t address, const uint8_t *data, uint16_t length, uint32_t timeout_us);
+    // Reads length bytes from the device
+    esp_err_t (*read)(void *context, uint8_t address, uint8_t *data, uint16_t length, uint32_t timeout_us);
+    // Writes then reads with a repeated start
+    esp_err_t (*write_read)(void *context, uint8_t address, const uint8_t *data, uint16_t length,
+                            uint8_t *buffer, uint16_t buffer_length, uint32_t timeout_us);
+    // Runs the transfers in one transaction, chained with repeated starts
+    // except after the transfers flagged stop, ended by a stop. Optional.
+    esp_err_t (*transfer)(void *context, const struct htu21_bus_transfer *transfers, uint32_t count,
+                          uint32_t timeout_us);
+    // Sets the SCL clock and the clock-stretch timeout, ESP_ERR_INVALID_ARG
+    // when the timeout is above the hardware limit. Optional.
+    esp_err_t (*set_speed)(void *context, uint32_t scl_hz, uint32_t stretch_timeout_us);
+    // Frees SDA and SCL when a device holds them low. Optional.
+    enum htu21_bus_recovery (*recover)(void *context);
+};
+
+struct htu21_bus {
+    const struct htu21_bus_ops *ops;
+    void *context;
+    // Serializes the transfers, NULL until htu21_bus_init
+    htu21_bus_lock_t lock;
+    // End of the reserved conversions (us), 0 : free slot. Under the lock.
+    int64_t reservations[HTU21_BUS_MAX_RESERVATIONS];
+    // Reserved conversions that found no free slot. Under the lock.
+    uint32_t overflowed;
+    // Speed profile last applied, 0 : platform default. Under the lock.
+    uint32_t scl_hz;
+    uint32_t stretch_timeout_us;
+};
+
+#ifdef ESP_PLATFORM
+// Transport over I2C_NUM_0, one command link per operation or batch
+extern const struct htu21_bus_ops htu21_bus_esp32_ops;
+#endif
+
+#ifdef __linux__
+// Transport over a Linux i2c-dev adapter, context : htu21_bus_linux*
+struct htu21_bus_linux {
+    // File descriptor of the opened /dev/i2c-N
+    int fd;
+    // Adapter timeout last set (us), 0 before the first transfer
+    uint32_t timeout_us;
+};
+
+extern const struct htu21_bus_ops htu21_bus_linux_ops;
+#endif
+
+// Functions
+
+/**
+ * \brief Initializes a bus and creates its lock, whatever the bus held
+ *        before. A bus initialized before is deinitialized first.
+ *
+ * \param[out] htu21_bus* : Bus to initialize
+ * \param[in] htu21_bus_ops* : Transport operations
+ * \param[in] void* : Context passed to the operations
+ *
+ * \return esp_err_t :
+ *       - ESP_OK : Bus ready
+ *       - ESP_ERR_NO_MEM : Lock could not be created
+ */
+esp_err_t htu21_bus_init(struct htu21_bus *, const struct htu21_bus_ops *, void *);
+
+/**
+ * \brief Deletes the lock of a bus. No transfer may be in progress.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_deinit(struct htu21_bus *);
+
+/**
+ * \brief Takes the bus lock. Does nothing on a bus without lock.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_lock(struct htu21_bus *);
+
+/**
+ * \brief Takes the bus lock, waiting at most the given time.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_bus_timeout_t : Timeout (ticks, ms outside ESP-IDF)
+ *
+ * \return bool : true when the lock was taken
+ */
+bool htu21_bus_try_lock(struct htu21_bus *, htu21_bus_timeout_t);
+
+/**
+ * \brief Gives the bus lock back.
+ *
+ * \param[in] htu21_bus* : Bus
+ */
+void htu21_bus_unlock(struct htu21_bus *);
+
+/**
+ * \brief Reserves the bus for the end of a conversion. Bus lock held.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int64_t : End of the conversion (us)
+ *
+ * \return int - Reservation slot, HTU21_BUS_RESERVATION_OVERFLOW when every
+ *         slot is in use.
+ */
+int htu21_bus_reserve(struct htu21_bus *, int64_t);
+
+/**
+ * \brief Frees a reservation. Bus lock held.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int : Slot returned by htu21_bus_reserve
+ */
+void htu21_bus_release_reservation(struct htu21_bus *, int);
+
+/**
+ * \brief Returns the time the bus stays free of HTU21 transfers. Bus lock
+ *        held, typically by another driver checking that its transfer fits.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Idle time (us), 0 when a conversion is already due or
+ *         a conversion found no free slot, HTU21_BUS_IDLE_FOREVER when
+ *         nothing is reserved.
+ */
+uint32_t htu21_bus_idle_time(const struct htu21_bus *, int64_t);
+
+/**
+ * \brief Switches the bus to a speed profile, bus lock held. Does nothing when
+ *        the profile is already applied or the transport cannot change it.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] uint32_t : SCL clock (Hz)
+ * \param[in] uint32_t : Clock-stretch timeout (us)
+ *
+ * \return esp_err_t :
+ *       - ESP_OK : Profile applied
+ *       - ESP_ERR_INVALID_ARG : Timeout above what the transport supports,
+ *         the bus is left as it is
+ *       - ESP_ERR_NOT_SUPPORTED : Transport without speed control
+ */
+esp_err_t htu21_bus_set_speed(struct htu21_bus *, uint32_t, uint32_t);
+
+/**
+ * \brief Checks the lines of the bus after a failed transfer, bus lock held.
+ *        When a device holds them low, clocks it out of its transfer and
+ *        sends a STOP.
+ *
+ * \param[in] htu21_bus* : Bus
+ *
+ * \return htu21_bus_recovery : outcome
+ *       - htu21_bus_not_stuck : Lines free, or transport without recovery
+ *       - htu21_bus_recovered : Lines were stuck and are free again
+ *       - htu21_bus_still_stuck : Lines still held low
+ */
+enum htu21_bus_recovery htu21_bus_recover(struct htu21_bus *);
+
+/**
+ * \brief Empties a batch.
+ *
+ * \param[out] htu21_bus_batch* : Batch
+ */
+void htu21_bus_batch_init(struct htu21_bus_batch *);
+
+/**
+ * \brief Queues a write in a batch.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : I2C address
+ * \param[in] uint8_t* : Data, valid until the batch is submitted
+ * \param[in] uint16_t : Length
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_bus_batch_write(struct htu21_bus_batch *, uint8_t, const uint8_t *, uint16_t);
+
+/**
+ * \brief Queues a read in a batch.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : I2C address
+ * \param[out] uint8_t* : Buffer, filled when the batch is submitted
+ * \param[in] uint16_t : Length
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_bus_batch_read(struct htu21_bus_batch *, uint8_t, uint8_t *, uint16_t);
+
+/**
+ * \brief Ends the last transfer queued in a batch with a stop.
+ *
+ * \param[in] htu21_bus_batch* : Batch
+ */
+void htu21_bus_batch_stop(struct htu21_bus_batch *);
+
+/**
+ * \brief Runs a batch. Bus lock held. With a transport that supports batches
+ *        the whole batch fails when one transfer fails.
+ *
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint32_t : Timeout of the batch (us)
+ *
+ * \return esp_err_t : ESP_OK when every transfer succeeded
+ */
+esp_err_t htu21_bus_batch_submit(struct htu21_bus *, const struct htu21_bus_batch *, uint32_t);
+
+#endif /* HTU21_BUS_H_INCLUDED */
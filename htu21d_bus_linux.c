@@ -0,0 +1,139 @@
+/**
+ * \file htu21d_bus_linux.c
+ *
+ * \brief HTU21 I2C bus transport over Linux i2c-dev source file
+ *
+ * Every operation is one I2C_RDWR ioctl, a batch included : the messages are
+ * chained with repeated starts and a single stop. A batch is only split
+ * after the transfers that need their own stop (mux selects).
+ *
+ * The SCL clock of a Linux adapter is fixed by the device tree. The timeout
+ * of each operation is applied with I2C_TIMEOUT (10 ms units), which bounds
+ * clock stretching as well.
+ * Stuck bus recovery is left to the kernel, whose adapter drivers run the
+ * same SCL pulse sequence when they detect it.
+ *
+ */
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "htu21d_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compile-time check : a batch fits in one I2C_RDWR ioctl
+typedef char htu21_bus_linux_batch_check[(HTU21_BUS_BATCH_MAX_TRANSFERS <= I2C_RDWR_IOCTL_MAX_MSGS) ? 1 : -1];
+
+static esp_err_t htu21_bus_linux_rdwr(void *context, struct i2c_msg *messages, uint32_t count, uint32_t timeout_us)
+{
+    struct htu21_bus_linux *bus = (struct htu21_bus_linux *) context;
+    struct i2c_rdwr_ioctl_data data = {
+        .msgs  = messages,
+        .nmsgs = count,
+    };
+
+    // Adapter-wide timeout, only set when the budget changes
+    if (bus->timeout_us != timeout_us) {
+        if (ioctl(bus->fd, I2C_TIMEOUT, (timeout_us + 9999) / 10000) != 0)
+            return ESP_FAIL;
+        bus->timeout_us = timeout_us;
+    }
+
+    if (ioctl(bus->fd, I2C_RDWR, &data) == (int) count)
+        return ESP_OK;
+    return (errno == ETIMEDOUT) ? ESP_ERR_TIMEOUT : ESP_FAIL;
+}
+
+static esp_err_t htu21_bus_linux_write(void *context, uint8_t address, const uint8_t *data, uint16_t length,
+                                       uint32_t timeout_us)
+{
+    struct i2c_msg message = {
+        .addr  = address,
+        .flags = 0,
+        .len   = length,
+        .buf   = (uint8_t *) data,
+    };
+
+    return htu21_bus_linux_rdwr(context, &message, 1, timeout_us);
+}
+
+static esp_err_t htu21_bus_linux_read(void *context, uint8_t address, uint8_t *data, uint16_t length,
+                                      uint32_t timeout_us)
+{
+    struct i2c_msg message = {
+        .addr  = address,
+        .flags = I2C_M_RD,
+        .len   = length,
+        .buf   = data,
+    };
+
+    return htu21_bus_linux_rdwr(context, &message, 1, timeout_us);
+}
+
+static esp_err_t htu21_bus_linux_write_read(void *context, uint8_t address, const uint8_t *data, uint16_t length,
+                                            uint8_t *buffer, uint16_t buffer_length, uint32_t timeout_us)
+{
+    struct i2c_msg messages[2] = {
+        {
+            .addr  = address,
+            .flags = 0,
+            .len   = length,
+            .buf   = (uint8_t *) data,
+        },
+        {
+            .addr  = address,
+            .flags = I2C_M_RD,
+            .len   = buffer_length,
+            .buf   = buffer,
+        },
+    };
+
+    return htu21_bus_linux_rdwr(context, messages, 2, timeout_us);
+}
+
+static esp_err_t htu21_bus_linux_transfer(void *context, const struct htu21_bus_transfer *transfers, uint32_t count,
+                                          uint32_t timeout_us)
+{
+    struct i2c_msg messages[HTU21_BUS_BATCH_MAX_TRANSFERS];
+    esp_err_t err = ESP_OK;
+    uint32_t first = 0, i;
+
+    if (count > HTU21_BUS_BATCH_MAX_TRANSFERS)
+        return ESP_ERR_INVALID_ARG;
+
+    for (i = 0; i < count; i++) {
+        messages[i].addr = transfers[i].address;
+        messages[i].flags = transfers[i].read ? I2C_M_RD : 0;
+        messages[i].len = transfers[i].length;
+        messages[i].buf = transfers[i].data;
+    }
+
+    // One ioctl per run of transfers ended by a stop
+    for (i = 0; i < count && err == ESP_OK; i++) {
+        if (!transfers[i].stop && i + 1 < count)
+            continue;
+        err = htu21_bus_linux_rdwr(context, &messages[first], i + 1 - first, timeout_us);
+        first = i + 1;
+    }
+
+    return err;
+}
+
+const struct htu21_bus_ops htu21_bus_linux_ops = {
+    .write      = htu21_bus_linux_write,
+    .read       = htu21_bus_linux_read,
+    .write_read = htu21_bus_linux_write_read,
+    .transfer   = htu21_bus_linux_transfer,
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __linux__ */
@@ -0,0 +1,65 @@
+/**
+ * \file htu21d_calibration.c
+ *
+ * \brief HTU21 per-sensor calibration source file
+ *
+ */
+
+#include "htu21d_calibration.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Returns the calibration of a serial number.
+ *
+ * \param[in] htu21_calibration* : Calibration table
+ * \param[in] uint32_t : Number of entries
+ * \param[in] uint64_t : Serial number
+ *
+ * \return htu21_calibration* - Entry, NULL when the sensor is not calibrated.
+ */
+const struct htu21_calibration *htu21_calibration_find(const struct htu21_calibration *table, uint32_t count,
+                                                       uint64_t serial_number)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+        if (table[i].serial_number == serial_number)
+            return &table[i];
+
+    return NULL;
+}
+
+/**
+ * \brief Reads the serial number of the device and applies its calibration.
+ *        A device missing from the table gets the datasheet conversion.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_calibration* : Calibration table
+ * \param[in] uint32_t : Number of entries
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_calibration_load(struct htu21_device *dev, const struct htu21_calibration *table,
+                                         uint32_t count)
+{
+    enum htu21_status status;
+    uint64_t serial_number;
+
+    status = htu21_dev_read_serial_number(dev, &serial_number);
+    if (status != htu21_status_ok)
+        return status;
+
+    htu21_dev_set_calibration(dev, htu21_calibration_find(table, count, serial_number));
+
+    return htu21_status_ok;
+}
+
+#ifdef __cplusplus
+}
+#endif
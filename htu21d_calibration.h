@@ -0,0 +1,68 @@
+/**
+ * \file htu21d_calibration.h
+ *
+ * \brief HTU21 per-sensor calibration header file
+ *
+ * Sensors calibrated in the field against a reference get a gain and an
+ * offset per channel, keyed by their serial number :
+ *
+ *     reference = gain * measured + offset
+ *
+ * The table is provided by the application, e.g. from flash or NVS, and
+ * searched once per device when it is loaded. The gain and offset are then
+ * folded into the conversion coefficients of the device (see
+ * htu21_dev_set_calibration) : a calibrated sample is converted with one
+ * multiply and one add, as a raw one.
+ *
+ * After htu21_fleet_init, the serial numbers of the results give the entry
+ * of each device without another read :
+ *
+ *     htu21_dev_set_calibration(devices[i], htu21_calibration_find(table, count, results[i].serial_number));
+ *
+ */
+
+#ifndef HTU21_CALIBRATION_H_INCLUDED
+#define HTU21_CALIBRATION_H_INCLUDED
+
+#include <stdint.h>
+#include "htu21d.h"
+
+// Folded once by htu21_dev_set_calibration, so kept in htu21_float_t in every
+// policy : a gain in hundredths would be too coarse.
+struct htu21_calibration {
+    uint64_t serial_number;
+    htu21_float_t temperature_gain;
+    htu21_float_t temperature_offset;    // degC
+    htu21_float_t humidity_gain;
+    htu21_float_t humidity_offset;        // %RH
+};
+
+// Functions
+
+/**
+ * \brief Returns the calibration of a serial number.
+ *
+ * \param[in] htu21_calibration* : Calibration table
+ * \param[in] uint32_t : Number of entries
+ * \param[in] uint64_t : Serial number
+ *
+ * \return htu21_calibration* - Entry, NULL when the sensor is not calibrated.
+ */
+const struct htu21_calibration *htu21_calibration_find(const struct htu21_calibration *, uint32_t, uint64_t);
+
+/**
+ * \brief Reads the serial number of the device and applies its calibration.
+ *        A device missing from the table gets the datasheet conversion.
+ *
+ * \param[in] htu21_device* : Device
+ * \param[in] htu21_calibration* : Calibration table
+ * \param[in] uint32_t : Number of entries
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_calibration_load(struct htu21_device *, const struct htu21_calibration *, uint32_t);
+
+#endif /* HTU21_CALIBRATION_H_INCLUDED */
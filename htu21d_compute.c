@@ -0,0 +1,24 @@
+/**
+ * \file htu21d_compute.c
+ *
+ * \brief HTU21 pure compute functions source file
+ *
+ * Provides the external definitions, whatever HTU21_INLINE_COMPUTE is.
+ *
+ */
+
+#define HTU21_COMPUTE_IMPLEMENTATION
+#include <math.h>
+#include "htu21d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#undef HTU21_COMPUTE_API
+#define HTU21_COMPUTE_API
+#include "htu21d_compute_impl.h"
+
+#ifdef __cplusplus
+}
+#endif
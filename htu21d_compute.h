@@ -0,0 +1,139 @@
+/**
+ * \file htu21d_compute.h
+ *
+ * \brief HTU21 pure compute functions header file
+ *
+ * ADC conversions, CRC check, humidity compensation and dew point. None of
+ * them touches the bus or the driver state.
+ *
+ * By default they are compiled once in htu21d_compute.c and linked as usual.
+ * With HTU21_INLINE_COMPUTE defined, e.g. in the component.mk :
+ *
+ *     CFLAGS += -DHTU21_INLINE_COMPUTE
+ *
+ * or before including htu21d.h in one source file, they become static inline
+ * in every file that includes this header, so the compiler can inline them
+ * into the caller loops and vectorize those loops without LTO. The external
+ * symbols stay available in both modes.
+ *
+ * Included by htu21d.h, after the enums.
+ *
+ */
+
+#ifndef HTU21_COMPUTE_H_INCLUDED
+#define HTU21_COMPUTE_H_INCLUDED
+
+#include <stdint.h>
+#include "htu21d_numeric.h"
+
+// Processing constants
+#define HTU21_TEMPERATURE_COEFFICIENT                        HTU21_REAL(-0.15)
+#define HTU21_CONSTANT_A                                    HTU21_FLOAT(8.1332)
+#define HTU21_CONSTANT_B                                    HTU21_FLOAT(1762.39)
+#define HTU21_CONSTANT_C                                    HTU21_FLOAT(235.66)
+
+// Coefficients for temperature computation
+#define TEMPERATURE_COEFF_MUL                                HTU21_REAL(175.72)
+#define TEMPERATURE_COEFF_ADD                                HTU21_REAL(-46.85)
+
+// Coefficients for relative humidity computation
+#define HUMIDITY_COEFF_MUL                                    HTU21_REAL(125)
+#define HUMIDITY_COEFF_ADD                                    HTU21_REAL(-6)
+
+// Status bits of the ADC codes, cleared by the conversions
+#define HTU21_ADC_STATUS_MASK                                0x0003
+#define HTU21_ADC_CODE(adc)                                 ((uint32_t) (adc) \
+                                                            & ~(uint32_t) HTU21_ADC_STATUS_MASK)
+
+// ADC code to physical value conversions (constant expressions)
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+// Coefficients in hundredths : 0.01 degC / 0.01 %RH, rounded, integer only
+#define HTU21_TEMPERATURE_FROM_ADC(adc)                                            \
+    ((htu21_real_t) ((HTU21_ADC_CODE(adc) * TEMPERATURE_COEFF_MUL + 0x8000) >> 16) \
+     + TEMPERATURE_COEFF_ADD)
+#define HTU21_HUMIDITY_FROM_ADC(adc)                                            \
+    ((htu21_real_t) ((HTU21_ADC_CODE(adc) * HUMIDITY_COEFF_MUL + 0x8000) >> 16) \
+     + HUMIDITY_COEFF_ADD)
+#else
+#define HTU21_TEMPERATURE_FROM_ADC(adc)                                       \
+    ((htu21_real_t) HTU21_ADC_CODE(adc) * TEMPERATURE_COEFF_MUL / (1UL << 16) \
+     + TEMPERATURE_COEFF_ADD)
+#define HTU21_HUMIDITY_FROM_ADC(adc)                                       \
+    ((htu21_real_t) HTU21_ADC_CODE(adc) * HUMIDITY_COEFF_MUL / (1UL << 16) \
+     + HUMIDITY_COEFF_ADD)
+#endif
+
+#if defined(HTU21_INLINE_COMPUTE) && !defined(HTU21_COMPUTE_IMPLEMENTATION)
+
+#define HTU21_COMPUTE_API                                    static inline
+#include "htu21d_compute_impl.h"
+
+#else
+
+// Functions
+
+/**
+ * \brief Check CRC
+ *
+ * \param[in] uint16_t : variable on which to check CRC
+ * \param[in] uint8_t : CRC value
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : CRC check is OK
+ *       - htu21_status_crc_error : CRC check error
+ */
+enum htu21_status htu21_crc_check(uint16_t, uint8_t);
+
+/**
+ * \brief Converts a temperature ADC value
+ *
+ * \param[in] uint16_t : Temperature ADC value, status bits ignored
+ *
+ * \return htu21_real_t - Temperature (degC).
+ */
+htu21_real_t htu21_convert_temperature(uint16_t);
+
+/**
+ * \brief Converts a relative humidity ADC value
+ *
+ * \param[in] uint16_t : Relative humidity ADC value, status bits ignored
+ *
+ * \return htu21_real_t - Relative humidity (%RH).
+ */
+htu21_real_t htu21_convert_humidity(uint16_t);
+
+/**
+ * \brief Returns result of compensated humidity
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Compensated humidity (%RH).
+ */
+htu21_real_t htu21_compute_compensated_humidity(htu21_real_t,htu21_real_t);
+
+/**
+ * \brief Returns the computed dew point
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (DegC).
+ */
+htu21_real_t htu21_compute_dew_point(htu21_real_t,htu21_real_t);
+
+/**
+ * \brief Returns the computed dew point, fast path.
+ *        Algebraically identical to htu21_compute_dew_point, computed with a
+ *        single log10.
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (DegC).
+ */
+htu21_real_t htu21_compute_dew_point_fast(htu21_real_t,htu21_real_t);
+
+#endif
+
+#endif /* HTU21_COMPUTE_H_INCLUDED */
@@ -0,0 +1,129 @@
+/**
+ * \file htu21d_compute_impl.h
+ *
+ * \brief HTU21 pure compute functions bodies
+ *
+ * Not to be included directly : included by htu21d_compute.h with
+ * HTU21_COMPUTE_API set to static inline, and by htu21d_compute.c with
+ * HTU21_COMPUTE_API empty.
+ *
+ */
+
+#ifndef HTU21_COMPUTE_API
+#error "htu21d_compute_impl.h is included by htu21d_compute.h and htu21d_compute.c only"
+#endif
+
+/**
+ * \brief Check CRC
+ *
+ * \param[in] uint16_t : variable on which to check CRC
+ * \param[in] uint8_t : CRC value
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : CRC check is OK
+ *       - htu21_status_crc_error : CRC check error
+ */
+HTU21_COMPUTE_API enum htu21_status htu21_crc_check(uint16_t value, uint8_t crc)
+{
+    uint32_t polynom = 0x988000; // x^8 + x^5 + x^4 + 1
+    uint32_t msb = 0x800000;
+    uint32_t mask = 0xFF8000;
+    uint32_t result = (uint32_t) value << 8; // Pad with zeros as specified in spec
+
+    while (msb != 0x80) {
+
+        // Check if msb of current value is 1 and apply XOR mask
+        if (result & msb)
+            result = ((result ^ polynom) & mask) | (result & ~mask);
+
+        // Shift by one
+        msb >>= 1;
+        mask >>= 1;
+        polynom >>= 1;
+    }
+    if (result == crc)
+        return htu21_status_ok;
+    else
+        return htu21_status_crc_error;
+}
+
+/**
+ * \brief Converts a temperature ADC value
+ *
+ * \param[in] uint16_t : Temperature ADC value, status bits ignored
+ *
+ * \return htu21_real_t - Temperature (degC).
+ */
+HTU21_COMPUTE_API htu21_real_t htu21_convert_temperature(uint16_t adc)
+{
+    return HTU21_TEMPERATURE_FROM_ADC(adc);
+}
+
+/**
+ * \brief Converts a relative humidity ADC value
+ *
+ * \param[in] uint16_t : Relative humidity ADC value, status bits ignored
+ *
+ * \return htu21_real_t - Relative humidity (%RH).
+ */
+HTU21_COMPUTE_API htu21_real_t htu21_convert_humidity(uint16_t adc)
+{
+    return HTU21_HUMIDITY_FROM_ADC(adc);
+}
+
+/**
+ * \brief Returns result of compensated humidity
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Compensated humidity (%RH).
+ */
+HTU21_COMPUTE_API htu21_real_t htu21_compute_compensated_humidity(htu21_real_t temperature,htu21_real_t relative_humidity)
+{
+    return relative_humidity + HTU21_REAL_MUL(HTU21_REAL(25) - temperature, HTU21_TEMPERATURE_COEFFICIENT);
+}
+
+/**
+ * \brief Returns the computed dew point
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (DegC).
+ */
+HTU21_COMPUTE_API htu21_real_t htu21_compute_dew_point(htu21_real_t temperature,htu21_real_t relative_humidity)
+{
+    htu21_float_t t = HTU21_REAL_TO_FLOAT(temperature);
+    htu21_float_t rh = HTU21_REAL_TO_FLOAT(relative_humidity);
+    htu21_float_t partial_pressure;
+    htu21_float_t dew_point;
+
+    // Missing power of 10
+    partial_pressure = HTU21_POW(10, HTU21_CONSTANT_A - HTU21_CONSTANT_B / (t + HTU21_CONSTANT_C));
+
+    dew_point = -HTU21_CONSTANT_B / (HTU21_LOG10(rh * partial_pressure / 100) - HTU21_CONSTANT_A) -
+                HTU21_CONSTANT_C;
+
+    return HTU21_REAL_FROM_FLOAT(dew_point);
+}
+
+/**
+ * \brief Returns the computed dew point, fast path.
+ *        Same formula as htu21_compute_dew_point, with the partial pressure
+ *        simplified out : log10(RH * 10^(A - B/(T+C)) / 100) - A
+ *        reduces to log10(RH / 100) - B/(T+C). One log10, no pow.
+ *
+ * \param[in] htu21_real_t - Actual temperature measured (degC)
+ * \param[in] htu21_real_t - Actual relative humidity measured (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (DegC).
+ */
+HTU21_COMPUTE_API htu21_real_t htu21_compute_dew_point_fast(htu21_real_t temperature,htu21_real_t relative_humidity)
+{
+    htu21_float_t t = HTU21_REAL_TO_FLOAT(temperature);
+    htu21_float_t rh = HTU21_REAL_TO_FLOAT(relative_humidity);
+
+    return HTU21_REAL_FROM_FLOAT(-HTU21_CONSTANT_B / (HTU21_LOG10(rh / 100) - HTU21_CONSTANT_B / (t + HTU21_CONSTANT_C))
+                                 - HTU21_CONSTANT_C);
+}
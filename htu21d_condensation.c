@@ -0,0 +1,138 @@
+/**
+ * \file htu21d_condensation.c
+ *
+ * \brief HTU21 condensation-risk detector source file
+ *
+ */
+
+#include <math.h>
+#include "htu21d.h"
+#include "htu21d_condensation.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Re-evaluates the margin and the risk state.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ *
+ * \return htu21_condensation_event : event raised by the evaluation
+ */
+static enum htu21_condensation_event htu21_condensation_evaluate(struct htu21_condensation_detector *det)
+{
+    if (!det->air_valid || !det->surface_valid)
+        return htu21_condensation_no_event;
+
+    det->margin = det->surface_temperature - det->dew_point;
+
+    if (!det->at_risk && det->margin < det->config.threshold) {
+        det->at_risk = true;
+        return htu21_condensation_risk_raised;
+    }
+    if (det->at_risk && det->margin > det->config.threshold + det->config.hysteresis) {
+        det->at_risk = false;
+        return htu21_condensation_risk_cleared;
+    }
+    return htu21_condensation_no_event;
+}
+
+/**
+ * \brief Fills a detector configuration with the default values.
+ *
+ * \param[out] htu21_condensation_config* : Configuration
+ */
+void htu21_condensation_default_config(struct htu21_condensation_config *config)
+{
+    config->threshold = HTU21_CONDENSATION_DEFAULT_THRESHOLD;
+    config->hysteresis = HTU21_CONDENSATION_DEFAULT_HYSTERESIS;
+    config->temperature_quantum = HTU21_CONDENSATION_DEFAULT_TEMPERATURE_QUANTUM;
+    config->humidity_quantum = HTU21_CONDENSATION_DEFAULT_HUMIDITY_QUANTUM;
+}
+
+/**
+ * \brief Initializes a condensation detector.
+ *
+ * \param[out] htu21_condensation_detector* : Detector to initialize
+ * \param[in] htu21_condensation_config* : Configuration
+ */
+void htu21_condensation_init(struct htu21_condensation_detector *det, const struct htu21_condensation_config *config)
+{
+    det->config = *config;
+    det->air_temperature = 0;
+    det->relative_humidity = 0;
+    det->dew_point = 0;
+    det->surface_temperature = 0;
+    det->margin = 0;
+    det->air_valid = false;
+    det->surface_valid = false;
+    det->at_risk = false;
+    det->dew_point_updates = 0;
+}
+
+/**
+ * \brief Feeds an air sample from the HTU21.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ * \param[in] float : Air temperature (degC)
+ * \param[in] float : Relative humidity (%RH)
+ *
+ * \return htu21_condensation_event : event raised by this sample
+ */
+enum htu21_condensation_event htu21_condensation_update_air(struct htu21_condensation_detector *det,
+                                                            float temperature, float relative_humidity)
+{
+    if (det->air_valid
+        && fabsf(temperature - det->air_temperature) < det->config.temperature_quantum
+        && fabsf(relative_humidity - det->relative_humidity) < det->config.humidity_quantum)
+        return htu21_condensation_no_event;
+
+    det->air_temperature = temperature;
+    det->relative_humidity = relative_humidity;
+    det->dew_point = (float) HTU21_REAL_TO_FLOAT(htu21_compute_dew_point_fast(HTU21_REAL_FROM_FLOAT(temperature),
+                                                                              HTU21_REAL_FROM_FLOAT(relative_humidity)));
+    det->air_valid = true;
+    det->dew_point_updates++;
+
+    return htu21_condensation_evaluate(det);
+}
+
+/**
+ * \brief Feeds a surface temperature sample.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ * \param[in] float : Surface temperature (degC)
+ *
+ * \return htu21_condensation_event : event raised by this sample
+ */
+enum htu21_condensation_event htu21_condensation_update_surface(struct htu21_condensation_detector *det,
+                                                                float surface_temperature)
+{
+    if (det->surface_valid
+        && fabsf(surface_temperature - det->surface_temperature) < det->config.temperature_quantum)
+        return htu21_condensation_no_event;
+
+    det->surface_temperature = surface_temperature;
+    det->surface_valid = true;
+
+    return htu21_condensation_evaluate(det);
+}
+
+/**
+ * \brief Returns the current dew point margin.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ *
+ * \return float - Surface temperature minus dew point (degC), NAN until both inputs were fed.
+ */
+float htu21_condensation_margin(const struct htu21_condensation_detector *det)
+{
+    if (!det->air_valid || !det->surface_valid)
+        return NAN;
+    return det->margin;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,109 @@
+/**
+ * \file htu21d_condensation.h
+ *
+ * \brief HTU21 condensation-risk detector header file
+ *
+ * Streaming comparison of the dew point of the air measured by the HTU21
+ * with a surface temperature coming from another probe. A risk event is
+ * raised when the surface gets closer than the threshold to the dew point,
+ * and cleared once the margin exceeds threshold + hysteresis.
+ *
+ * The dew point is recomputed with htu21_compute_dew_point_fast, and only
+ * when temperature or humidity moved by more than their quantum since the
+ * last computation.
+ *
+ */
+
+#ifndef HTU21_CONDENSATION_H_INCLUDED
+#define HTU21_CONDENSATION_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Default detector configuration
+#define HTU21_CONDENSATION_DEFAULT_THRESHOLD                (float)(2.0)    // degC
+#define HTU21_CONDENSATION_DEFAULT_HYSTERESIS                (float)(0.5)    // degC
+#define HTU21_CONDENSATION_DEFAULT_TEMPERATURE_QUANTUM        (float)(0.05)    // degC
+#define HTU21_CONDENSATION_DEFAULT_HUMIDITY_QUANTUM            (float)(0.2)    // %RH
+
+enum htu21_condensation_event {
+    htu21_condensation_no_event,
+    htu21_condensation_risk_raised,
+    htu21_condensation_risk_cleared
+};
+
+struct htu21_condensation_config {
+    // Dew point margin below which the risk is raised (degC)
+    float threshold;
+    // Extra margin needed to clear the risk (degC)
+    float hysteresis;
+    // Input changes below these quanta are ignored
+    float temperature_quantum;
+    float humidity_quantum;
+};
+
+struct htu21_condensation_detector {
+    struct htu21_condensation_config config;
+    // Inputs the dew point was last computed from
+    float air_temperature;
+    float relative_humidity;
+    float dew_point;
+    // Surface temperature the margin was last evaluated with
+    float surface_temperature;
+    // Surface temperature minus dew point (degC)
+    float margin;
+    bool air_valid;
+    bool surface_valid;
+    bool at_risk;
+    // Number of dew point computations performed
+    uint32_t dew_point_updates;
+};
+
+// Functions
+
+/**
+ * \brief Fills a detector configuration with the default values.
+ *
+ * \param[out] htu21_condensation_config* : Configuration
+ */
+void htu21_condensation_default_config(struct htu21_condensation_config *);
+
+/**
+ * \brief Initializes a condensation detector.
+ *
+ * \param[out] htu21_condensation_detector* : Detector to initialize
+ * \param[in] htu21_condensation_config* : Configuration
+ */
+void htu21_condensation_init(struct htu21_condensation_detector *, const struct htu21_condensation_config *);
+
+/**
+ * \brief Feeds an air sample from the HTU21.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ * \param[in] float : Air temperature (degC)
+ * \param[in] float : Relative humidity (%RH)
+ *
+ * \return htu21_condensation_event : event raised by this sample
+ */
+enum htu21_condensation_event htu21_condensation_update_air(struct htu21_condensation_detector *, float, float);
+
+/**
+ * \brief Feeds a surface temperature sample.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ * \param[in] float : Surface temperature (degC)
+ *
+ * \return htu21_condensation_event : event raised by this sample
+ */
+enum htu21_condensation_event htu21_condensation_update_surface(struct htu21_condensation_detector *, float);
+
+/**
+ * \brief Returns the current dew point margin.
+ *
+ * \param[in] htu21_condensation_detector* : Detector
+ *
+ * \return float - Surface temperature minus dew point (degC), NAN until both inputs were fed.
+ */
+float htu21_condensation_margin(const struct htu21_condensation_detector *);
+
+#endif /* HTU21_CONDENSATION_H_INCLUDED */
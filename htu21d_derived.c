@@ -0,0 +1,198 @@
+/**
+ * \file htu21d_derived.c
+ *
+ * \brief HTU21 derived metrics source file
+ *
+ */
+
+// Dew point and conversions inlined into the batch loops
+#ifndef HTU21_INLINE_COMPUTE
+#define HTU21_INLINE_COMPUTE
+#endif
+
+#include <math.h>
+#include "htu21d.h"
+#include "htu21d_psychro.h"
+#include "htu21d_derived.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Physical constants
+#define HTU21_DERIVED_LN10                                    HTU21_FLOAT(2.302585093)
+#define HTU21_DERIVED_ZERO_CELSIUS                            HTU21_FLOAT(273.15)    // K
+#define HTU21_DERIVED_VAPOR_DENSITY_FACTOR                    HTU21_FLOAT(2.166794)    // 1000 / Rv (g.K/J)
+#define HTU21_DERIVED_MOLAR_MASS_RATIO                        HTU21_FLOAT(621.945)    // 1000 * Mw / Md (g/kg)
+#define HTU21_DERIVED_CP_DRY_AIR                            HTU21_FLOAT(1.006)        // kJ/kg/K
+#define HTU21_DERIVED_CP_VAPOR                                HTU21_FLOAT(1.86)        // kJ/kg/K
+#define HTU21_DERIVED_LATENT_HEAT                            HTU21_FLOAT(2501)        // kJ/kg
+
+// Metrics that need the vapor pressure
+#define HTU21_DERIVED_NEEDS_VAPOR_PRESSURE                          \
+    (HTU21_DERIVED_VAPOR_PRESSURE | HTU21_DERIVED_ABSOLUTE_HUMIDITY \
+     | HTU21_DERIVED_MIXING_RATIO | HTU21_DERIVED_ENTHALPY)
+
+// The metrics are computed in htu21_float_t, see htu21d_numeric.h
+
+static inline htu21_float_t htu21_derived_saturation_pressure(htu21_float_t temperature)
+{
+    return HTU21_EXP(HTU21_DERIVED_LN10 * (HTU21_CONSTANT_A - HTU21_CONSTANT_B / (temperature + HTU21_CONSTANT_C)))
+           * HTU21_PSYCHRO_PA_PER_MMHG;
+}
+
+static inline htu21_float_t htu21_derived_absolute_humidity(htu21_float_t temperature, htu21_float_t vapor_pressure)
+{
+    return HTU21_DERIVED_VAPOR_DENSITY_FACTOR * vapor_pressure / (temperature + HTU21_DERIVED_ZERO_CELSIUS);
+}
+
+static inline htu21_float_t htu21_derived_mixing_ratio(htu21_float_t vapor_pressure, htu21_float_t pressure)
+{
+    return HTU21_DERIVED_MOLAR_MASS_RATIO * vapor_pressure / (pressure - vapor_pressure);
+}
+
+static inline htu21_float_t htu21_derived_enthalpy(htu21_float_t temperature, htu21_float_t mixing_ratio)
+{
+    return HTU21_DERIVED_CP_DRY_AIR * temperature
+           + mixing_ratio / 1000 * (HTU21_DERIVED_LATENT_HEAT + HTU21_DERIVED_CP_VAPOR * temperature);
+}
+
+/**
+ * \brief NWS heat index (Rothfusz regression with its adjustments, simple
+ *        formula below 80 degF), computed in degF and returned in degC.
+ */
+static inline htu21_float_t htu21_derived_heat_index(htu21_float_t temperature, htu21_float_t relative_humidity)
+{
+    htu21_float_t f = temperature * HTU21_FLOAT(1.8) + 32;
+    htu21_float_t rh = relative_humidity;
+    htu21_float_t simple = HTU21_FLOAT(0.5) * (f + 61 + (f - 68) * HTU21_FLOAT(1.2) + rh * HTU21_FLOAT(0.094));
+    htu21_float_t full = HTU21_FLOAT(-42.379) + HTU21_FLOAT(2.04901523) * f + HTU21_FLOAT(10.14333127) * rh
+                         - HTU21_FLOAT(0.22475541) * f * rh - HTU21_FLOAT(6.83783e-3) * f * f
+                         - HTU21_FLOAT(5.481717e-2) * rh * rh + HTU21_FLOAT(1.22874e-3) * f * f * rh
+                         + HTU21_FLOAT(8.5282e-4) * f * rh * rh - HTU21_FLOAT(1.99e-6) * f * f * rh * rh;
+
+    if (rh < 13 && f > 80 && f < 112)
+        full -= (13 - rh) / 4 * HTU21_SQRT((17 - HTU21_FABS(f - 95)) / 17);
+    if (rh > 85 && f > 80 && f < 87)
+        full += (rh - 85) / 10 * ((87 - f) / 5);
+
+    f = ((simple + f) / 2 < 80) ? simple : full;
+    return (f - 32) / HTU21_FLOAT(1.8);
+}
+
+/**
+ * \brief Computes the selected derived metrics of one sample.
+ *        Fields of unselected metrics are left untouched.
+ *
+ * \param[in] htu21_psychro* : Psychrometrics context caching the saturation
+ *                             vapor pressure, NULL to compute it directly
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ * \param[in] htu21_real_t : Atmospheric pressure (Pa)
+ * \param[in] uint32_t : HTU21_DERIVED_xxx selection mask
+ * \param[out] htu21_derived_metrics* : Computed metrics
+ */
+void htu21_derived_compute(struct htu21_psychro *ctx, htu21_real_t temperature, htu21_real_t relative_humidity,
+                           htu21_real_t pressure, uint32_t mask, struct htu21_derived_metrics *out)
+{
+    htu21_float_t t = HTU21_REAL_TO_FLOAT(temperature);
+    htu21_float_t rh = HTU21_REAL_TO_FLOAT(relative_humidity);
+    htu21_float_t vapor_pressure = 0;
+    htu21_float_t mixing_ratio = 0;
+
+    if (mask & HTU21_DERIVED_NEEDS_VAPOR_PRESSURE) {
+        if (ctx != NULL)
+            vapor_pressure = HTU21_REAL_TO_FLOAT(htu21_psychro_vapor_pressure(ctx, temperature, relative_humidity));
+        else
+            vapor_pressure = htu21_derived_saturation_pressure(t) * rh / 100;
+    }
+    if (mask & (HTU21_DERIVED_MIXING_RATIO | HTU21_DERIVED_ENTHALPY))
+        mixing_ratio = htu21_derived_mixing_ratio(vapor_pressure, HTU21_REAL_TO_FLOAT(pressure));
+
+    if (mask & HTU21_DERIVED_VAPOR_PRESSURE)
+        out->vapor_pressure = HTU21_REAL_FROM_FLOAT(vapor_pressure);
+    if (mask & HTU21_DERIVED_ABSOLUTE_HUMIDITY)
+        out->absolute_humidity = HTU21_REAL_FROM_FLOAT(htu21_derived_absolute_humidity(t, vapor_pressure));
+    if (mask & HTU21_DERIVED_MIXING_RATIO)
+        out->mixing_ratio = HTU21_REAL_FROM_FLOAT(mixing_ratio);
+    if (mask & HTU21_DERIVED_ENTHALPY)
+        out->enthalpy = HTU21_REAL_FROM_FLOAT(htu21_derived_enthalpy(t, mixing_ratio));
+    if (mask & HTU21_DERIVED_HEAT_INDEX)
+        out->heat_index = HTU21_REAL_FROM_FLOAT(htu21_derived_heat_index(t, rh));
+    if (mask & HTU21_DERIVED_DEW_POINT)
+        out->dew_point = htu21_compute_dew_point_fast(temperature, relative_humidity);
+}
+
+/**
+ * \brief Computes the selected derived metrics of an array of samples.
+ *
+ * \param[in] htu21_real_t* : Temperatures (degC)
+ * \param[in] htu21_real_t* : Relative humidities (%RH)
+ * \param[in] size_t : Number of samples
+ * \param[in] htu21_real_t : Atmospheric pressure (Pa)
+ * \param[in] uint32_t : HTU21_DERIVED_xxx selection mask
+ * \param[out] htu21_derived_batch* : Output arrays, one per selected metric
+ */
+void htu21_derived_compute_batch(const htu21_real_t *temperature, const htu21_real_t *relative_humidity,
+                                 size_t count, htu21_real_t pressure, uint32_t mask,
+                                 const struct htu21_derived_batch *out)
+{
+    htu21_float_t vapor_pressure[HTU21_DERIVED_BATCH_BLOCK];
+    htu21_float_t mixing_ratio[HTU21_DERIVED_BATCH_BLOCK];
+    size_t base, n, i;
+
+    for (base = 0; base < count; base += n) {
+        const htu21_real_t *__restrict t = temperature + base;
+        const htu21_real_t *__restrict rh = relative_humidity + base;
+
+        n = count - base;
+        if (n > HTU21_DERIVED_BATCH_BLOCK)
+            n = HTU21_DERIVED_BATCH_BLOCK;
+
+        // Shared terms first, then one branch-free loop per selected metric
+        if (mask & HTU21_DERIVED_NEEDS_VAPOR_PRESSURE)
+            for (i = 0; i < n; i++)
+                vapor_pressure[i] = htu21_derived_saturation_pressure(HTU21_REAL_TO_FLOAT(t[i]))
+                                    * HTU21_REAL_TO_FLOAT(rh[i]) / 100;
+        if (mask & (HTU21_DERIVED_MIXING_RATIO | HTU21_DERIVED_ENTHALPY))
+            for (i = 0; i < n; i++)
+                mixing_ratio[i] = htu21_derived_mixing_ratio(vapor_pressure[i], HTU21_REAL_TO_FLOAT(pressure));
+
+        if (mask & HTU21_DERIVED_VAPOR_PRESSURE) {
+            htu21_real_t *__restrict o = out->vapor_pressure + base;
+            for (i = 0; i < n; i++)
+                o[i] = HTU21_REAL_FROM_FLOAT(vapor_pressure[i]);
+        }
+        if (mask & HTU21_DERIVED_ABSOLUTE_HUMIDITY) {
+            htu21_real_t *__restrict o = out->absolute_humidity + base;
+            for (i = 0; i < n; i++)
+                o[i] = HTU21_REAL_FROM_FLOAT(htu21_derived_absolute_humidity(HTU21_REAL_TO_FLOAT(t[i]),
+                                                                             vapor_pressure[i]));
+        }
+        if (mask & HTU21_DERIVED_MIXING_RATIO) {
+            htu21_real_t *__restrict o = out->mixing_ratio + base;
+            for (i = 0; i < n; i++)
+                o[i] = HTU21_REAL_FROM_FLOAT(mixing_ratio[i]);
+        }
+        if (mask & HTU21_DERIVED_ENTHALPY) {
+            htu21_real_t *__restrict o = out->enthalpy + base;
+            for (i = 0; i < n; i++)
+                o[i] = HTU21_REAL_FROM_FLOAT(htu21_derived_enthalpy(HTU21_REAL_TO_FLOAT(t[i]), mixing_ratio[i]));
+        }
+        if (mask & HTU21_DERIVED_HEAT_INDEX) {
+            htu21_real_t *__restrict o = out->heat_index + base;
+            for (i = 0; i < n; i++)
+                o[i] = HTU21_REAL_FROM_FLOAT(htu21_derived_heat_index(HTU21_REAL_TO_FLOAT(t[i]),
+                                                                      HTU21_REAL_TO_FLOAT(rh[i])));
+        }
+        if (mask & HTU21_DERIVED_DEW_POINT) {
+            htu21_real_t *__restrict o = out->dew_point + base;
+            for (i = 0; i < n; i++)
+                o[i] = htu21_compute_dew_point_fast(t[i], rh[i]);
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
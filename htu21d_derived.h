@@ -0,0 +1,89 @@
+/**
+ * \file htu21d_derived.h
+ *
+ * \brief HTU21 derived metrics header file
+ *
+ * Computes any subset of the humidity derived metrics in one pass. The
+ * metrics share the vapor pressure term, which is computed once per sample
+ * and only when a selected metric needs it. Unselected metrics cost nothing.
+ *
+ * The batch variant works on arrays, block by block, with one loop per
+ * selected metric and no branch inside the loops, so the compiler can
+ * vectorize them on targets that have SIMD units.
+ *
+ */
+
+#ifndef HTU21_DERIVED_H_INCLUDED
+#define HTU21_DERIVED_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include "htu21d_numeric.h"
+
+struct htu21_psychro;
+
+// Metric selection mask
+#define HTU21_DERIVED_VAPOR_PRESSURE                        0x01    // Pa
+#define HTU21_DERIVED_ABSOLUTE_HUMIDITY                        0x02    // g/m3
+#define HTU21_DERIVED_MIXING_RATIO                            0x04    // g/kg of dry air
+#define HTU21_DERIVED_ENTHALPY                                0x08    // kJ/kg of dry air
+#define HTU21_DERIVED_HEAT_INDEX                            0x10    // degC
+#define HTU21_DERIVED_DEW_POINT                                0x20    // degC
+#define HTU21_DERIVED_ALL                                    0x3F
+
+// Sea level pressure, for the metrics that depend on pressure
+#define HTU21_DERIVED_STANDARD_PRESSURE                        HTU21_REAL(101325)    // Pa
+
+// Number of samples processed per block by the batch variant
+#define HTU21_DERIVED_BATCH_BLOCK                            32
+
+struct htu21_derived_metrics {
+    htu21_real_t vapor_pressure;
+    htu21_real_t absolute_humidity;
+    htu21_real_t mixing_ratio;
+    htu21_real_t enthalpy;
+    htu21_real_t heat_index;
+    htu21_real_t dew_point;
+};
+
+// Output arrays of the batch variant. Arrays of unselected metrics may be NULL.
+struct htu21_derived_batch {
+    htu21_real_t *vapor_pressure;
+    htu21_real_t *absolute_humidity;
+    htu21_real_t *mixing_ratio;
+    htu21_real_t *enthalpy;
+    htu21_real_t *heat_index;
+    htu21_real_t *dew_point;
+};
+
+// Functions
+
+/**
+ * \brief Computes the selected derived metrics of one sample.
+ *        Fields of unselected metrics are left untouched.
+ *
+ * \param[in] htu21_psychro* : Psychrometrics context caching the saturation
+ *                             vapor pressure, NULL to compute it directly
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ * \param[in] htu21_real_t : Atmospheric pressure (Pa)
+ * \param[in] uint32_t : HTU21_DERIVED_xxx selection mask
+ * \param[out] htu21_derived_metrics* : Computed metrics
+ */
+void htu21_derived_compute(struct htu21_psychro *, htu21_real_t, htu21_real_t, htu21_real_t, uint32_t,
+                           struct htu21_derived_metrics *);
+
+/**
+ * \brief Computes the selected derived metrics of an array of samples.
+ *
+ * \param[in] htu21_real_t* : Temperatures (degC)
+ * \param[in] htu21_real_t* : Relative humidities (%RH)
+ * \param[in] size_t : Number of samples
+ * \param[in] htu21_real_t : Atmospheric pressure (Pa)
+ * \param[in] uint32_t : HTU21_DERIVED_xxx selection mask
+ * \param[out] htu21_derived_batch* : Output arrays, one per selected metric
+ */
+void htu21_derived_compute_batch(const htu21_real_t *, const htu21_real_t *, size_t, htu21_real_t, uint32_t,
+                                 const struct htu21_derived_batch *);
+
+#endif /* HTU21_DERIVED_H_INCLUDED */
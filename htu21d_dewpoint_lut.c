@@ -0,0 +1,146 @@
+/**
+ * \file htu21d_dewpoint_lut.c
+ *
+ * \brief HTU21 dew point lookup table source file
+ *
+ */
+
+#ifndef HTU21_INLINE_COMPUTE
+#define HTU21_INLINE_COMPUTE
+#endif
+
+#include <math.h>
+#include "htu21d.h"
+#include "htu21d_dewpoint_lut.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTU21_DP_LUT_TEMPERATURE_SHIFT                        (16 - HTU21_DP_LUT_TEMPERATURE_BITS)
+#define HTU21_DP_LUT_HUMIDITY_SHIFT                            (16 - HTU21_DP_LUT_HUMIDITY_BITS)
+
+/**
+ * \brief Fills the dew point grid. Uses htu21_compute_dew_point on every node.
+ *
+ * \param[out] htu21_dp_lut* : Table to fill
+ */
+void htu21_dp_lut_init(struct htu21_dp_lut *lut)
+{
+    uint32_t i, j;
+
+    // The last nodes sit at code 0x10000, out of uint16_t : macros, not htu21_convert_xxx
+    for (i = 0; i < HTU21_DP_LUT_TEMPERATURE_NODES; i++) {
+        htu21_real_t temperature = HTU21_TEMPERATURE_FROM_ADC(i << HTU21_DP_LUT_TEMPERATURE_SHIFT);
+
+        for (j = 0; j < HTU21_DP_LUT_HUMIDITY_NODES; j++) {
+            htu21_real_t humidity = HTU21_HUMIDITY_FROM_ADC(j << HTU21_DP_LUT_HUMIDITY_SHIFT);
+
+            if (humidity < HTU21_DP_LUT_MIN_HUMIDITY)
+                humidity = HTU21_DP_LUT_MIN_HUMIDITY;
+            if (humidity > HTU21_REAL(100))
+                humidity = HTU21_REAL(100);
+            lut->grid[i][j] = (float) HTU21_REAL_TO_FLOAT(htu21_compute_dew_point(temperature, humidity));
+        }
+    }
+}
+
+/**
+ * \brief Returns the dew point of one sample.
+ *
+ * \param[in] htu21_dp_lut* : Table
+ * \param[in] uint16_t : Temperature ADC value
+ * \param[in] uint16_t : Relative humidity ADC value
+ *
+ * \return htu21_real_t - Dew point temperature (degC).
+ */
+htu21_real_t htu21_dp_lut_dew_point(const struct htu21_dp_lut *lut, uint16_t temperature_adc, uint16_t humidity_adc)
+{
+    uint32_t i = temperature_adc >> HTU21_DP_LUT_TEMPERATURE_SHIFT;
+    uint32_t j = humidity_adc >> HTU21_DP_LUT_HUMIDITY_SHIFT;
+    htu21_float_t u = (htu21_float_t) (temperature_adc & ((1 << HTU21_DP_LUT_TEMPERATURE_SHIFT) - 1))
+                      * (HTU21_FLOAT(1) / (1 << HTU21_DP_LUT_TEMPERATURE_SHIFT));
+    htu21_float_t v = (htu21_float_t) (humidity_adc & ((1 << HTU21_DP_LUT_HUMIDITY_SHIFT) - 1))
+                      * (HTU21_FLOAT(1) / (1 << HTU21_DP_LUT_HUMIDITY_SHIFT));
+    const float *row0 = lut->grid[i];
+    const float *row1 = lut->grid[i + 1];
+    htu21_float_t low = row0[j] + (row0[j + 1] - row0[j]) * v;
+    htu21_float_t high = row1[j] + (row1[j + 1] - row1[j]) * v;
+
+    return HTU21_REAL_FROM_FLOAT(low + (high - low) * u);
+}
+
+/**
+ * \brief Returns the dew point of an array of samples.
+ *
+ * \param[in] htu21_dp_lut* : Table
+ * \param[in] uint16_t* : Temperature ADC values
+ * \param[in] uint16_t* : Relative humidity ADC values
+ * \param[out] htu21_real_t* : Dew point temperatures (degC)
+ * \param[in] size_t : Number of samples
+ */
+void htu21_dp_lut_dew_point_batch(const struct htu21_dp_lut *lut, const uint16_t *temperature_adc,
+                                  const uint16_t *humidity_adc, htu21_real_t *dew_point, size_t count)
+{
+    size_t n;
+
+    for (n = 0; n < count; n++)
+        dew_point[n] = htu21_dp_lut_dew_point(lut, temperature_adc[n], humidity_adc[n]);
+}
+
+/**
+ * \brief Measures the error of the table against htu21_compute_dew_point over
+ *        -40..125 degC and the given humidity range.
+ *
+ * \param[in] htu21_dp_lut* : Table
+ * \param[in] uint16_t : Step between the evaluated ADC codes
+ * \param[in] htu21_real_t : Lowest relative humidity evaluated (%RH)
+ * \param[out] htu21_dp_lut_error* : Error report
+ */
+void htu21_dp_lut_error_report(const struct htu21_dp_lut *lut, uint16_t step, htu21_real_t min_humidity,
+                               struct htu21_dp_lut_error *report)
+{
+    double sum = 0;
+    uint32_t t, h;
+
+    report->max_error = 0;
+    report->mean_error = 0;
+    report->worst_temperature_adc = 0;
+    report->worst_humidity_adc = 0;
+    report->samples = 0;
+
+    if (step == 0)
+        step = 1;
+
+    for (t = 0; t <= 0xFFFF; t += step) {
+        htu21_real_t temperature = htu21_convert_temperature((uint16_t) t);
+
+        if (temperature < HTU21_REAL(-40) || temperature > HTU21_REAL(125))
+            continue;
+
+        for (h = 0; h <= 0xFFFF; h += step) {
+            htu21_real_t humidity = htu21_convert_humidity((uint16_t) h);
+            htu21_real_t error;
+
+            if (humidity < min_humidity || humidity > HTU21_REAL(100))
+                continue;
+
+            error = HTU21_ABS(htu21_dp_lut_dew_point(lut, (uint16_t) t, (uint16_t) h)
+                              - htu21_compute_dew_point(temperature, humidity));
+            sum += HTU21_REAL_TO_FLOAT(error);
+            report->samples++;
+            if (error > report->max_error) {
+                report->max_error = error;
+                report->worst_temperature_adc = (uint16_t) t;
+                report->worst_humidity_adc = (uint16_t) h;
+            }
+        }
+    }
+
+    if (report->samples != 0)
+        report->mean_error = HTU21_REAL_FROM_FLOAT((htu21_float_t) (sum / report->samples));
+}
+
+#ifdef __cplusplus
+}
+#endif
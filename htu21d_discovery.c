@@ -0,0 +1,177 @@
+/**
+ * \file htu21d_discovery.c
+ *
+ * \brief HTU21 hot-plug discovery source file
+ *
+ */
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "htu21d_discovery.h"
+#include "htu21d_family.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void htu21_discovery_attach(struct htu21_discovery *discovery, struct htu21_discovery_slot *slot,
+                                   uint64_t serial_number, int64_t now_us)
+{
+    // A sensor plugged in after another one starts from its power-on
+    // settings : drop the calibration, resolution and heater state of the
+    // last one, and keep the family its serial number gave
+    if (slot->serial_number != 0) {
+        htu21_dev_init(&slot->device, discovery->bus, HTU21_DEFAULT_ADDRESS);
+        htu21_dev_set_mux(&slot->device, discovery->mux, (uint8_t) (slot - discovery->slots));
+        htu21_dev_set_family(&slot->device, htu21_family_detect(serial_number));
+    }
+
+    slot->present = true;
+    slot->serial_number = serial_number;
+    slot->misses = 0;
+    slot->scheduled = (discovery->scheduler != NULL)
+                      && htu21_scheduler_add(discovery->scheduler, &slot->job, &slot->device, discovery->period_ms,
+                                             0, now_us, discovery->job_callback, discovery->job_arg);
+
+    if (discovery->callback != NULL)
+        discovery->callback(discovery, slot, true, discovery->arg);
+}
+
+static void htu21_discovery_detach(struct htu21_discovery *discovery, struct htu21_discovery_slot *slot)
+{
+    if (slot->scheduled)
+        htu21_scheduler_remove(discovery->scheduler, &slot->job);
+    slot->scheduled = false;
+    slot->present = false;
+
+    if (discovery->callback != NULL)
+        discovery->callback(discovery, slot, false, discovery->arg);
+}
+
+static bool htu21_discovery_idle(void *arg, int64_t now_us, uint32_t idle_us)
+{
+    return htu21_discovery_step((struct htu21_discovery *) arg, now_us, idle_us);
+}
+
+/**
+ * \brief Initializes discovery on the channels of a mux, or on a bus without
+ *        mux. No sensor is attached until probed.
+ *
+ * \param[out] htu21_discovery* : Discovery to initialize
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_mux* : Mux of the bus, NULL for a single sensor on the bus
+ * \param[in] htu21_discovery_callback : Attach and detach callback, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_discovery_init(struct htu21_discovery *discovery, struct htu21_bus *bus, struct htu21_mux *mux,
+                          htu21_discovery_callback callback, void *arg)
+{
+    uint8_t i;
+
+    discovery->bus = bus;
+    discovery->mux = mux;
+    discovery->channels = (mux != NULL) ? mux->channels : 1;
+    discovery->callback = callback;
+    discovery->arg = arg;
+    discovery->scheduler = NULL;
+    discovery->period_ms = 0;
+    discovery->job_callback = NULL;
+    discovery->job_arg = NULL;
+    discovery->next_channel = 0;
+    discovery->next_probe_us = 0;
+
+    for (i = 0; i < discovery->channels; i++) {
+        struct htu21_discovery_slot *slot = &discovery->slots[i];
+
+        htu21_dev_init(&slot->device, bus, HTU21_DEFAULT_ADDRESS);
+        htu21_dev_set_mux(&slot->device, mux, i);
+        slot->serial_number = 0;
+        slot->present = false;
+        slot->scheduled = false;
+        slot->misses = 0;
+    }
+}
+
+/**
+ * \brief Registers the attached sensors as periodic jobs of a scheduler, and
+ *        runs discovery as its idle hook. To be called before the scheduler
+ *        task starts.
+ *
+ * \param[in] htu21_discovery* : Discovery
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] uint32_t : Period of the jobs (ms)
+ * \param[in] htu21_job_callback : Callback of the jobs, may be NULL
+ * \param[in] void* : Argument of the job callback
+ */
+void htu21_discovery_set_scheduler(struct htu21_discovery *discovery, struct htu21_scheduler *scheduler,
+                                   uint32_t period_ms, htu21_job_callback job_callback, void *job_arg)
+{
+    discovery->scheduler = scheduler;
+    discovery->period_ms = period_ms;
+    discovery->job_callback = job_callback;
+    discovery->job_arg = job_arg;
+    htu21_scheduler_set_idle_hook(scheduler, htu21_discovery_idle, discovery);
+}
+
+/**
+ * \brief Probes the next channel when it is due and the bus has the time.
+ *
+ * \param[in] htu21_discovery* : Discovery
+ * \param[in] int64_t : Current time (us)
+ * \param[in] uint32_t : Time available before the next job (us)
+ *
+ * \return bool : true when the bus was used
+ */
+bool htu21_discovery_step(struct htu21_discovery *discovery, int64_t now_us, uint32_t idle_us)
+{
+    struct htu21_discovery_slot *slot = &discovery->slots[discovery->next_channel];
+    uint32_t cost = HTU21_DISCOVERY_IDENTIFY_US;
+    enum htu21_status status;
+    uint64_t serial_number;
+
+    if (now_us < discovery->next_probe_us || idle_us < cost)
+        return false;
+
+    // Skip the turn rather than wait for the bus or delay a conversion : the
+    // probe runs under the bus lock taken without waiting
+    if (!htu21_dev_try_identify(&slot->device, cost, &serial_number, &status))
+        return false;
+
+    discovery->next_channel = (discovery->next_channel + 1) % discovery->channels;
+    discovery->next_probe_us = now_us + HTU21_DISCOVERY_INTERVAL_MS * 1000;
+
+    if (status != htu21_status_no_i2c_acknowledge) {
+        slot->misses = 0;
+        // A sensor swapped between two probes answers too : identify it each time
+        if (status != htu21_status_ok)
+            return true;
+        if (slot->present && slot->serial_number != serial_number)
+            htu21_discovery_detach(discovery, slot);
+        if (!slot->present)
+            htu21_discovery_attach(discovery, slot, serial_number, now_us);
+    } else if (slot->present && ++slot->misses >= HTU21_DISCOVERY_MISSES) {
+        htu21_discovery_detach(discovery, slot);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Discovery task body, without scheduler : probes forever.
+ *
+ * \param[in] void* : htu21_discovery*
+ */
+void htu21_discovery_task(void *arg)
+{
+    struct htu21_discovery *discovery = (struct htu21_discovery *) arg;
+
+    for (;;) {
+        htu21_discovery_step(discovery, esp_timer_get_time(), HTU21_BUS_IDLE_FOREVER);
+        vTaskDelay((HTU21_DISCOVERY_INTERVAL_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+/**
+ * \file htu21d_discovery.h
+ *
+ * \brief HTU21 hot-plug discovery header file
+ *
+ * Finds the sensors plugged on the channels of a mux, or on a bus without
+ * mux, and follows their insertion and removal in the field. One channel is
+ * probed per HTU21_DISCOVERY_INTERVAL_MS, so that a full sweep costs a few
+ * short transfers spread over time. Every probe that gets an answer reads
+ * the serial number. A newcomer is attached : registered as a job of the
+ * scheduler, and reported to the callback. A sensor that misses
+ * HTU21_DISCOVERY_MISSES probes in a row is detached. A sensor swapped
+ * faster than that shows as another serial number on its channel : the old
+ * one is detached and the new one attached. A sensor attached to a channel
+ * that held one before gets a freshly initialized device, matching the
+ * power-on settings of the part : the callback reapplies the application
+ * settings (calibration, resolution, heater, governor...).
+ *
+ * Discovery never makes sampling wait. It only runs when the time left
+ * before the next job and the next conversion of the bus covers the probe,
+ * and skips its turn when the bus is taken. Attached to a scheduler it runs
+ * as its idle hook, on the scheduler task. Without scheduler,
+ * htu21_discovery_task runs it on its own.
+ *
+ */
+
+#ifndef HTU21_DISCOVERY_H_INCLUDED
+#define HTU21_DISCOVERY_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+#include "htu21d_mux.h"
+#include "htu21d_scheduler.h"
+
+// One channel probed per interval (ms)
+#ifndef HTU21_DISCOVERY_INTERVAL_MS
+#define HTU21_DISCOVERY_INTERVAL_MS                            250
+#endif
+
+// Failed probes in a row before a sensor is detached
+#ifndef HTU21_DISCOVERY_MISSES
+#define HTU21_DISCOVERY_MISSES                                2
+#endif
+
+// Bus time of a probe followed by a serial number read (us)
+#define HTU21_DISCOVERY_IDENTIFY_US                            3000
+
+struct htu21_discovery;
+struct htu21_discovery_slot;
+
+// Called on the discovery task when a sensor is attached or detached
+typedef void (*htu21_discovery_callback)(struct htu21_discovery *, struct htu21_discovery_slot *, bool, void *);
+
+struct htu21_discovery_slot {
+    struct htu21_device device;
+    struct htu21_job job;
+    uint64_t serial_number;
+    bool present;
+    bool scheduled;
+    uint8_t misses;
+};
+
+struct htu21_discovery {
+    struct htu21_bus *bus;
+    struct htu21_mux *mux;
+    uint8_t channels;
+    htu21_discovery_callback callback;
+    void *arg;
+    // Optional scheduler the attached sensors are registered with
+    struct htu21_scheduler *scheduler;
+    uint32_t period_ms;
+    htu21_job_callback job_callback;
+    void *job_arg;
+    // Next channel to probe, and when
+    uint8_t next_channel;
+    int64_t next_probe_us;
+    struct htu21_discovery_slot slots[HTU21_MUX_MAX_CHANNELS];
+};
+
+// Functions
+
+/**
+ * \brief Initializes discovery on the channels of a mux, or on a bus without
+ *        mux. No sensor is attached until probed.
+ *
+ * \param[out] htu21_discovery* : Discovery to initialize
+ * \param[in] htu21_bus* : Bus
+ * \param[in] htu21_mux* : Mux of the bus, NULL for a single sensor on the bus
+ * \param[in] htu21_discovery_callback : Attach and detach callback, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_discovery_init(struct htu21_discovery *, struct htu21_bus *, struct htu21_mux *,
+                          htu21_discovery_callback, void *);
+
+/**
+ * \brief Registers the attached sensors as periodic jobs of a scheduler, and
+ *        runs discovery as its idle hook. To be called before the scheduler
+ *        task starts.
+ *
+ * \param[in] htu21_discovery* : Discovery
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] uint32_t : Period of the jobs (ms)
+ * \param[in] htu21_job_callback : Callback of the jobs, may be NULL
+ * \param[in] void* : Argument of the job callback
+ */
+void htu21_discovery_set_scheduler(struct htu21_discovery *, struct htu21_scheduler *, uint32_t,
+                                   htu21_job_callback, void *);
+
+/**
+ * \brief Probes the next channel when it is due and the bus has the time.
+ *
+ * \param[in] htu21_discovery* : Discovery
+ * \param[in] int64_t : Current time (us)
+ * \param[in] uint32_t : Time available before the next job (us)
+ *
+ * \return bool : true when the bus was used
+ */
+bool htu21_discovery_step(struct htu21_discovery *, int64_t, uint32_t);
+
+/**
+ * \brief Discovery task body, without scheduler : probes forever.
+ *
+ * \param[in] void* : htu21_discovery*
+ */
+void htu21_discovery_task(void *);
+
+#endif /* HTU21_DISCOVERY_H_INCLUDED */
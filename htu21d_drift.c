@@ -0,0 +1,209 @@
+/**
+ * \file htu21d_drift.c
+ *
+ * \brief HTU21 long-term drift tracker source file
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "rom/crc.h"
+#include "htu21d_drift.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Returns a value in hundredths of its unit.
+ */
+static inline int16_t htu21_drift_hundredths(htu21_real_t value)
+{
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+    return (int16_t) value;
+#else
+    return (int16_t) lround(value * 100);
+#endif
+}
+
+/**
+ * \brief Returns a value given in hundredths of its unit.
+ */
+static inline htu21_real_t htu21_drift_value(int64_t hundredths)
+{
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+    return (htu21_real_t) hundredths;
+#else
+    return (htu21_real_t) hundredths / 100;
+#endif
+}
+
+/**
+ * \brief Returns the mean of samples, rounded to the nearest hundredth.
+ */
+static inline int64_t htu21_drift_mean(int64_t sum, uint32_t samples)
+{
+    int64_t half = (sum < 0) ? -(int64_t) (samples / 2) : (int64_t) (samples / 2);
+
+    return (sum + half) / (int64_t) samples;
+}
+
+static void htu21_drift_day_init(struct htu21_drift_day *day, uint32_t number)
+{
+    memset(day, 0, sizeof(*day));
+    day->day = number;
+}
+
+/**
+ * \brief Initializes an empty record for a sensor.
+ *
+ * \param[out] htu21_drift_record* : Record to initialize
+ * \param[in] uint64_t : Serial number of the sensor
+ */
+void htu21_drift_init(struct htu21_drift_record *record, uint64_t serial_number)
+{
+    // Padding included, so that the CRC only depends on the fields
+    memset(record, 0, sizeof(*record));
+    record->version = HTU21_DRIFT_VERSION;
+    record->serial_number = serial_number;
+}
+
+/**
+ * \brief Accounts one sample. Samples older than the last one are ignored.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint32_t : Time of the sample (s, wall clock)
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ */
+void htu21_drift_update(struct htu21_drift_record *record, uint32_t now_s, htu21_real_t temperature_value,
+                        htu21_real_t humidity_value)
+{
+    int16_t temperature = htu21_drift_hundredths(temperature_value);
+    int16_t humidity = htu21_drift_hundredths(humidity_value);
+    uint32_t number = now_s / HTU21_DRIFT_DAY_S;
+    struct htu21_drift_day *day;
+
+    if (record->days != 0) {
+        uint32_t gap;
+
+        if (now_s < record->last_s)
+            return;
+
+        // Exposure since the last sample, on the day of the last sample
+        gap = now_s - record->last_s;
+        if (record->last_high) {
+            if (gap > HTU21_DRIFT_MAX_GAP_S)
+                gap = HTU21_DRIFT_MAX_GAP_S;
+            record->ring[record->head].high_humidity_s += gap;
+            record->high_humidity_total_s += gap;
+        }
+    }
+
+    // A new day overwrites the oldest one
+    if (record->days == 0 || record->ring[record->head].day != number) {
+        record->head = (record->days == 0) ? 0 : (record->head + 1) % HTU21_DRIFT_DAYS;
+        if (record->days < HTU21_DRIFT_DAYS)
+            record->days++;
+        htu21_drift_day_init(&record->ring[record->head], number);
+    }
+
+    day = &record->ring[record->head];
+    if (day->samples == 0 || temperature < day->temperature_min)
+        day->temperature_min = temperature;
+    if (day->samples == 0 || temperature > day->temperature_max)
+        day->temperature_max = temperature;
+    if (day->samples == 0 || humidity < day->humidity_min)
+        day->humidity_min = humidity;
+    if (day->samples == 0 || humidity > day->humidity_max)
+        day->humidity_max = humidity;
+    day->temperature_sum += temperature;
+    day->humidity_sum += humidity;
+    day->samples++;
+
+    record->last_s = now_s;
+    record->last_high = (humidity > HTU21_DRIFT_HIGH_HUMIDITY * 100);
+}
+
+/**
+ * \brief Aggregates the last days of a record.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint32_t : Number of days, most recent first
+ * \param[out] htu21_drift_summary* : Aggregate
+ *
+ * \return bool : false when the record has no day
+ */
+bool htu21_drift_summarize(const struct htu21_drift_record *record, uint32_t days,
+                           struct htu21_drift_summary *summary)
+{
+    int16_t temperature_min = 0, temperature_max = 0, humidity_min = 0, humidity_max = 0;
+    int64_t temperature_sum = 0, humidity_sum = 0;
+    uint32_t i;
+
+    memset(summary, 0, sizeof(*summary));
+    if (days > record->days)
+        days = record->days;
+
+    for (i = 0; i < days; i++) {
+        const struct htu21_drift_day *day = &record->ring[(record->head + HTU21_DRIFT_DAYS - i) % HTU21_DRIFT_DAYS];
+
+        if (i == 0 || day->temperature_min < temperature_min)
+            temperature_min = day->temperature_min;
+        if (i == 0 || day->temperature_max > temperature_max)
+            temperature_max = day->temperature_max;
+        if (i == 0 || day->humidity_min < humidity_min)
+            humidity_min = day->humidity_min;
+        if (i == 0 || day->humidity_max > humidity_max)
+            humidity_max = day->humidity_max;
+        temperature_sum += day->temperature_sum;
+        humidity_sum += day->humidity_sum;
+        summary->samples += day->samples;
+        summary->high_humidity_s += day->high_humidity_s;
+    }
+
+    summary->days = days;
+    summary->temperature_min = htu21_drift_value(temperature_min);
+    summary->temperature_max = htu21_drift_value(temperature_max);
+    summary->humidity_min = htu21_drift_value(humidity_min);
+    summary->humidity_max = htu21_drift_value(humidity_max);
+    if (summary->samples != 0) {
+        summary->temperature_mean = htu21_drift_value(htu21_drift_mean(temperature_sum, summary->samples));
+        summary->humidity_mean = htu21_drift_value(htu21_drift_mean(humidity_sum, summary->samples));
+    }
+
+    return days != 0;
+}
+
+/**
+ * \brief Sets the CRC of a record, before it is stored.
+ *
+ * \param[in] htu21_drift_record* : Record
+ */
+void htu21_drift_seal(struct htu21_drift_record *record)
+{
+    record->crc = crc32_le(0, (const uint8_t *) record, offsetof(struct htu21_drift_record, crc));
+}
+
+/**
+ * \brief Checks a record read back from storage : layout version, sensor and
+ *        CRC.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint64_t : Serial number of the sensor
+ *
+ * \return bool : true when the record is valid for the sensor
+ */
+bool htu21_drift_check(const struct htu21_drift_record *record, uint64_t serial_number)
+{
+    return record->version == HTU21_DRIFT_VERSION
+           && record->serial_number == serial_number
+           && record->days <= HTU21_DRIFT_DAYS
+           && record->head < HTU21_DRIFT_DAYS
+           && record->crc == crc32_le(0, (const uint8_t *) record, offsetof(struct htu21_drift_record, crc));
+}
+
+#ifdef __cplusplus
+}
+#endif
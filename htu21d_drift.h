@@ -0,0 +1,145 @@
+/**
+ * \file htu21d_drift.h
+ *
+ * \brief HTU21 long-term drift tracker header file
+ *
+ * The humidity reading of an HTU21 drifts after long exposure to high
+ * humidity. A drift record follows one sensor, identified by its serial
+ * number, over the last HTU21_DRIFT_DAYS days with samples : per day the
+ * minimum, maximum and mean of both channels, and the time spent above
+ * HTU21_DRIFT_HIGH_HUMIDITY, plus the total time above it over the life of
+ * the sensor.
+ *
+ * Each sample updates the record in constant time, with no history kept.
+ * Values are kept in integer hundredths (0.01 degC, 0.01 %RH), the sums on
+ * 64 bits : they stay exact over any number of samples, and a record reads
+ * back the same whatever the numeric policy of the build.
+ * Timestamps are wall clock seconds, so that a record carries over reboots :
+ * the record is a flat structure, sealed with a CRC-32 by htu21_drift_seal
+ * before it is stored (flash, NVS, or a fleet server), and checked by
+ * htu21_drift_check when read back.
+ *
+ */
+
+#ifndef HTU21_DRIFT_H_INCLUDED
+#define HTU21_DRIFT_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+// Days kept in a record
+#ifndef HTU21_DRIFT_DAYS
+#define HTU21_DRIFT_DAYS                                    32
+#endif
+
+// Relative humidity above which exposure time is accounted (%RH)
+#ifndef HTU21_DRIFT_HIGH_HUMIDITY
+#define HTU21_DRIFT_HIGH_HUMIDITY                            80
+#endif
+
+// Longest gap between two samples accounted as exposure (s)
+#ifndef HTU21_DRIFT_MAX_GAP_S
+#define HTU21_DRIFT_MAX_GAP_S                                3600
+#endif
+
+// Layout version of the record, part of its CRC
+#define HTU21_DRIFT_VERSION                                    2
+
+#define HTU21_DRIFT_DAY_S                                    86400
+
+struct htu21_drift_day {
+    // Day number since the epoch of the timestamps
+    uint32_t day;
+    uint32_t samples;
+    // Sums of the samples (0.01 degC, 0.01 %RH)
+    int64_t temperature_sum;
+    int64_t humidity_sum;
+    // Extremes (0.01 degC, 0.01 %RH)
+    int16_t temperature_min;
+    int16_t temperature_max;
+    int16_t humidity_min;
+    int16_t humidity_max;
+    // Time above HTU21_DRIFT_HIGH_HUMIDITY (s)
+    uint32_t high_humidity_s;
+};
+
+struct htu21_drift_record {
+    uint32_t version;
+    uint64_t serial_number;
+    // Time of the last sample (s), and whether it was above the threshold
+    uint32_t last_s;
+    bool last_high;
+    // Days in use, the current one at head
+    uint32_t days;
+    uint32_t head;
+    // Time above HTU21_DRIFT_HIGH_HUMIDITY since the record was created (s)
+    uint64_t high_humidity_total_s;
+    struct htu21_drift_day ring[HTU21_DRIFT_DAYS];
+    // CRC-32 of the bytes above, set by htu21_drift_seal
+    uint32_t crc;
+};
+
+// Aggregate of the last days of a record
+struct htu21_drift_summary {
+    uint32_t days;
+    uint32_t samples;
+    htu21_real_t temperature_min;
+    htu21_real_t temperature_max;
+    htu21_real_t temperature_mean;
+    htu21_real_t humidity_min;
+    htu21_real_t humidity_max;
+    htu21_real_t humidity_mean;
+    uint32_t high_humidity_s;
+};
+
+// Functions
+
+/**
+ * \brief Initializes an empty record for a sensor.
+ *
+ * \param[out] htu21_drift_record* : Record to initialize
+ * \param[in] uint64_t : Serial number of the sensor
+ */
+void htu21_drift_init(struct htu21_drift_record *, uint64_t);
+
+/**
+ * \brief Accounts one sample. Samples older than the last one are ignored.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint32_t : Time of the sample (s, wall clock)
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ */
+void htu21_drift_update(struct htu21_drift_record *, uint32_t, htu21_real_t, htu21_real_t);
+
+/**
+ * \brief Aggregates the last days of a record.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint32_t : Number of days, most recent first
+ * \param[out] htu21_drift_summary* : Aggregate
+ *
+ * \return bool : false when the record has no day
+ */
+bool htu21_drift_summarize(const struct htu21_drift_record *, uint32_t, struct htu21_drift_summary *);
+
+/**
+ * \brief Sets the CRC of a record, before it is stored.
+ *
+ * \param[in] htu21_drift_record* : Record
+ */
+void htu21_drift_seal(struct htu21_drift_record *);
+
+/**
+ * \brief Checks a record read back from storage : layout version, sensor and
+ *        CRC.
+ *
+ * \param[in] htu21_drift_record* : Record
+ * \param[in] uint64_t : Serial number of the sensor
+ *
+ * \return bool : true when the record is valid for the sensor
+ */
+bool htu21_drift_check(const struct htu21_drift_record *, uint64_t);
+
+#endif /* HTU21_DRIFT_H_INCLUDED */
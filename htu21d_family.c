@@ -0,0 +1,102 @@
+/**
+ * \file htu21d_family.c
+ *
+ * \brief HTU21 sensor family descriptors source file
+ *
+ */
+
+#include "htu21d_family.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Si70xx device identification, SNB_3
+#define HTU21_FAMILY_SI7013_ID                                0x0D
+#define HTU21_FAMILY_SI7020_ID                                0x14
+#define HTU21_FAMILY_SI7021_ID                                0x15
+#define HTU21_FAMILY_SI70XX_SAMPLE_ID_0                        0x00
+#define HTU21_FAMILY_SI70XX_SAMPLE_ID_1                        0xFF
+
+// Si70xx command reading the temperature of the last humidity conversion, no CRC
+#define HTU21_FAMILY_SI70XX_READ_PREVIOUS_TEMPERATURE_COMMAND    0xE0
+
+const struct htu21_family htu21_family_htu21d = {
+    .name = "HTU21D",
+    .temperature_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 50000,
+        [htu21_resolution_t_12b_rh_8b]  = 13000,
+        [htu21_resolution_t_13b_rh_10b] = 25000,
+        [htu21_resolution_t_11b_rh_11b] = 7000,
+    },
+    .humidity_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 16000,
+        [htu21_resolution_t_12b_rh_8b]  = 3000,
+        [htu21_resolution_t_13b_rh_10b] = 5000,
+        [htu21_resolution_t_11b_rh_11b] = 8000,
+    },
+};
+
+const struct htu21_family htu21_family_sht21 = {
+    .name = "SHT21",
+    .temperature_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 85000,
+        [htu21_resolution_t_12b_rh_8b]  = 22000,
+        [htu21_resolution_t_13b_rh_10b] = 43000,
+        [htu21_resolution_t_11b_rh_11b] = 11000,
+    },
+    .humidity_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 29000,
+        [htu21_resolution_t_12b_rh_8b]  = 4000,
+        [htu21_resolution_t_13b_rh_10b] = 9000,
+        [htu21_resolution_t_11b_rh_11b] = 15000,
+    },
+};
+
+// A humidity conversion includes a temperature conversion : RH + T times
+const struct htu21_family htu21_family_si70xx = {
+    .name = "Si70xx",
+    .temperature_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 10800,
+        [htu21_resolution_t_12b_rh_8b]  = 3800,
+        [htu21_resolution_t_13b_rh_10b] = 6200,
+        [htu21_resolution_t_11b_rh_11b] = 2400,
+    },
+    .humidity_conversion_time = {
+        [htu21_resolution_t_14b_rh_12b] = 12000 + 10800,
+        [htu21_resolution_t_12b_rh_8b]  = 3100 + 3800,
+        [htu21_resolution_t_13b_rh_10b] = 4500 + 6200,
+        [htu21_resolution_t_11b_rh_11b] = 7000 + 2400,
+    },
+    .capabilities = HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY,
+    .read_previous_temperature_command = HTU21_FAMILY_SI70XX_READ_PREVIOUS_TEMPERATURE_COMMAND,
+};
+
+/**
+ * \brief Returns the family of a part from its serial number, as read by
+ *        htu21_dev_read_serial_number.
+ *
+ * \param[in] uint64_t : Serial number
+ *
+ * \return htu21_family* - Family descriptor.
+ */
+const struct htu21_family *htu21_family_detect(uint64_t serial_number)
+{
+    if ((serial_number & 0xFFFF) == HTU21_FAMILY_TE_SIGNATURE)
+        return &htu21_family_htu21d;
+
+    switch ((serial_number >> 24) & 0xFF) {
+    case HTU21_FAMILY_SI7013_ID:
+    case HTU21_FAMILY_SI7020_ID:
+    case HTU21_FAMILY_SI7021_ID:
+    case HTU21_FAMILY_SI70XX_SAMPLE_ID_0:
+    case HTU21_FAMILY_SI70XX_SAMPLE_ID_1:
+        return &htu21_family_si70xx;
+    default:
+        return &htu21_family_sht21;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,87 @@
+/**
+ * \file htu21d_family.h
+ *
+ * \brief HTU21 sensor family descriptors header file
+ *
+ * HTU20D/HTU21D (TE), SHT21 (Sensirion) and Si7013/Si7020/Si7021 (Silicon
+ * Labs) share the command set, the user register and the conversion
+ * formulas. They differ in conversion times, and the Si70xx have command
+ * extensions : a humidity conversion measures the temperature as well, read
+ * back with 0xE0 without a second conversion.
+ *
+ * A family descriptor holds what differs. Devices start as HTU21D, and
+ * htu21_dev_read_serial_number switches them to the family of their
+ * electronic ID :
+ *
+ *     SNA = 0x4854 ("HT")                          HTU21D
+ *     SNB_3 = 0x0D, 0x14, 0x15 (0x00, 0xFF samples)  Si7013, Si7020, Si7021
+ *     otherwise                                      SHT21
+ *
+ * The fast paths of the capabilities are then taken by the measurement
+ * functions without further setup.
+ *
+ */
+
+#ifndef HTU21_FAMILY_H_INCLUDED
+#define HTU21_FAMILY_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+// Capabilities
+// The humidity conversion measures the temperature, read back without conversion
+#define HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY            0x01
+
+// Signature of TE parts in the low 16 bits of the serial number
+#define HTU21_FAMILY_TE_SIGNATURE                            0x4854
+
+struct htu21_family {
+    const char *name;
+    // Maximum conversion times, indexed by enum htu21_resolution (us)
+    uint32_t temperature_conversion_time[4];
+    uint32_t humidity_conversion_time[4];
+    // HTU21_FAMILY_CAP_*
+    uint32_t capabilities;
+    // Command reading the temperature of the last humidity conversion, with
+    // HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY
+    uint8_t read_previous_temperature_command;
+};
+
+extern const struct htu21_family htu21_family_htu21d;
+extern const struct htu21_family htu21_family_sht21;
+extern const struct htu21_family htu21_family_si70xx;
+
+/**
+ * \brief Returns whether the family has all the given capabilities.
+ */
+static inline bool htu21_family_has(const struct htu21_family *family, uint32_t capabilities)
+{
+    return (family->capabilities & capabilities) == capabilities;
+}
+
+/**
+ * \brief Returns the time of one temperature and humidity measurement : a
+ *        single humidity conversion when it measures the temperature too.
+ */
+static inline uint32_t htu21_family_measurement_time(const struct htu21_family *family,
+                                                     enum htu21_resolution resolution)
+{
+    if (htu21_family_has(family, HTU21_FAMILY_CAP_TEMPERATURE_FROM_HUMIDITY))
+        return family->humidity_conversion_time[resolution];
+    return family->temperature_conversion_time[resolution] + family->humidity_conversion_time[resolution];
+}
+
+// Functions
+
+/**
+ * \brief Returns the family of a part from its serial number, as read by
+ *        htu21_dev_read_serial_number.
+ *
+ * \param[in] uint64_t : Serial number
+ *
+ * \return htu21_family* - Family descriptor.
+ */
+const struct htu21_family *htu21_family_detect(uint64_t);
+
+#endif /* HTU21_FAMILY_H_INCLUDED */
@@ -0,0 +1,180 @@
+/**
+ * \file htu21d_governor.c
+ *
+ * \brief HTU21 self-heating duty-cycle governor source file
+ *
+ */
+
+#include <stddef.h>
+#include "htu21d_governor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static struct htu21_governor_event *htu21_governor_event_at(struct htu21_governor *gov, uint8_t i)
+{
+    return &gov->events[(gov->first + i) % HTU21_GOVERNOR_HISTORY];
+}
+
+/**
+ * \brief Initializes a governor.
+ *
+ * \param[out] htu21_governor* : Governor to initialize
+ * \param[in] uint32_t : Sliding window length (ms), at most
+ *                       HTU21_GOVERNOR_MAX_WINDOW_MS
+ * \param[in] uint16_t : Duty cycle limit (permille)
+ */
+void htu21_governor_init(struct htu21_governor *gov, uint32_t window_ms, uint16_t duty_limit)
+{
+    if (window_ms > HTU21_GOVERNOR_MAX_WINDOW_MS)
+        window_ms = HTU21_GOVERNOR_MAX_WINDOW_MS;
+    gov->window_us = window_ms * 1000;
+    gov->first = 0;
+    gov->count = 0;
+    htu21_governor_set_duty_limit(gov, duty_limit);
+}
+
+/**
+ * \brief Set the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] uint16_t : Duty cycle limit (permille, 1 to 1000)
+ */
+void htu21_governor_set_duty_limit(struct htu21_governor *gov, uint16_t duty_limit)
+{
+    if (duty_limit == 0)
+        duty_limit = 1;
+    if (duty_limit > 1000)
+        duty_limit = 1000;
+    gov->duty_limit = duty_limit;
+}
+
+/**
+ * \brief Get the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ *
+ * \return uint16_t - Duty cycle limit (permille).
+ */
+uint16_t htu21_governor_get_duty_limit(const struct htu21_governor *gov)
+{
+    return gov->duty_limit;
+}
+
+/**
+ * \brief Records a conversion issued to the device.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Time the conversion was triggered (us)
+ * \param[in] uint32_t : Conversion time (us)
+ */
+void htu21_governor_record(struct htu21_governor *gov, int64_t start_us, uint32_t duration_us)
+{
+    struct htu21_governor_event *event;
+
+    if (gov->count == HTU21_GOVERNOR_HISTORY) {
+        // Merge the two oldest conversions into the most recent of them so that
+        // their active time stays in the window as long as possible.
+        struct htu21_governor_event *oldest = htu21_governor_event_at(gov, 0);
+        struct htu21_governor_event *next = htu21_governor_event_at(gov, 1);
+
+        next->duration_us += oldest->duration_us;
+        gov->first = (gov->first + 1) % HTU21_GOVERNOR_HISTORY;
+        gov->count--;
+    }
+
+    event = htu21_governor_event_at(gov, gov->count);
+    event->end_us = start_us + duration_us;
+    event->duration_us = duration_us;
+    gov->count++;
+}
+
+/**
+ * \brief Returns the duty cycle over the window ending now.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint16_t - Duty cycle (permille).
+ */
+uint16_t htu21_governor_duty_cycle(const struct htu21_governor *gov, int64_t now_us)
+{
+    int64_t window_start = now_us - gov->window_us;
+    uint64_t active = 0;
+    uint8_t i;
+
+    for (i = 0; i < gov->count; i++) {
+        const struct htu21_governor_event *event = &gov->events[(gov->first + i) % HTU21_GOVERNOR_HISTORY];
+        int64_t start = event->end_us - event->duration_us;
+        int64_t end = event->end_us;
+
+        if (start < window_start)
+            start = window_start;
+        if (end > now_us)
+            end = now_us;
+        if (end > start)
+            active += end - start;
+    }
+
+    if (gov->window_us == 0)
+        return 0;
+    active = active * 1000 / gov->window_us;
+    return (active > 1000) ? 1000 : (uint16_t) active;
+}
+
+/**
+ * \brief Returns how long to wait before the next conversion can be triggered
+ *        without exceeding the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Current time (us)
+ * \param[in] uint32_t : Conversion time of the planned measurement (us)
+ *
+ * \return uint32_t - Delay before triggering (us), 0 if the trigger is allowed now.
+ */
+uint32_t htu21_governor_next_trigger_delay(const struct htu21_governor *gov, int64_t now_us, uint32_t duration_us)
+{
+    int64_t allowance = (int64_t) gov->window_us * gov->duty_limit / 1000 - duration_us;
+    int64_t used = 0;
+    int i;
+
+    if (allowance < 0)
+        allowance = 0;
+
+    // The planned conversion ends the window. Walk back from the newest
+    // conversion and find the first one that no longer fits the allowance :
+    // the window must start late enough to leave only part of it inside.
+    for (i = (int) gov->count - 1; i >= 0; i--) {
+        const struct htu21_governor_event *event = &gov->events[(gov->first + i) % HTU21_GOVERNOR_HISTORY];
+        int64_t trigger;
+
+        if (used + event->duration_us <= allowance) {
+            used += event->duration_us;
+            continue;
+        }
+
+        trigger = event->end_us - (allowance - used) + gov->window_us - duration_us;
+        return (trigger > now_us) ? (uint32_t) (trigger - now_us) : 0;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Returns the shortest sampling period the limit allows in steady state.
+ *        Schedulers should not request samples faster than this.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] uint32_t : Conversion time of one measurement (us)
+ *
+ * \return uint32_t - Minimum sampling period (us).
+ */
+uint32_t htu21_governor_min_period(const struct htu21_governor *gov, uint32_t duration_us)
+{
+    return (uint32_t) ((uint64_t) duration_us * 1000 / gov->duty_limit);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+/**
+ * \file htu21d_governor.h
+ *
+ * \brief HTU21 self-heating duty-cycle governor header file
+ *
+ * The HTU21 dissipates about 500 uA while converting. Sampled back to back it
+ * heats itself and the temperature reading drifts upward. The datasheet
+ * recommends keeping the measurement duty cycle at or below 10 %.
+ *
+ * The governor keeps a short history of the conversions issued to one device
+ * and computes, for a sliding window, how long the next trigger has to be
+ * delayed so that the duty cycle stays under the configured limit.
+ *
+ */
+
+#ifndef HTU21_GOVERNOR_H_INCLUDED
+#define HTU21_GOVERNOR_H_INCLUDED
+
+#include <stdint.h>
+
+// Number of conversions remembered per device. When the history is full the
+// two oldest entries are merged, which can only over-estimate the duty cycle.
+#ifndef HTU21_GOVERNOR_HISTORY
+#define HTU21_GOVERNOR_HISTORY                                16
+#endif
+
+// Default limits (datasheet : duty cycle <= 10 %)
+#define HTU21_GOVERNOR_DEFAULT_DUTY_LIMIT                    100        // permille
+#define HTU21_GOVERNOR_DEFAULT_WINDOW_MS                    10000    // ms value
+
+// Longest window, held in us on 32 bits (about 71 min). Longer ones are clamped.
+#define HTU21_GOVERNOR_MAX_WINDOW_MS                        (UINT32_MAX / 1000)
+
+struct htu21_governor_event {
+    // End of the conversion (us)
+    int64_t end_us;
+    // Time spent converting (us)
+    uint32_t duration_us;
+};
+
+struct htu21_governor {
+    // Length of the sliding window (us)
+    uint32_t window_us;
+    // Maximum duty cycle over the window (permille)
+    uint16_t duty_limit;
+    // Index of the oldest event and number of valid events
+    uint8_t first;
+    uint8_t count;
+    struct htu21_governor_event events[HTU21_GOVERNOR_HISTORY];
+};
+
+// Functions
+
+/**
+ * \brief Initializes a governor.
+ *
+ * \param[out] htu21_governor* : Governor to initialize
+ * \param[in] uint32_t : Sliding window length (ms), at most
+ *                       HTU21_GOVERNOR_MAX_WINDOW_MS
+ * \param[in] uint16_t : Duty cycle limit (permille)
+ */
+void htu21_governor_init(struct htu21_governor *, uint32_t, uint16_t);
+
+/**
+ * \brief Set the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] uint16_t : Duty cycle limit (permille, 1 to 1000)
+ */
+void htu21_governor_set_duty_limit(struct htu21_governor *, uint16_t);
+
+/**
+ * \brief Get the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ *
+ * \return uint16_t - Duty cycle limit (permille).
+ */
+uint16_t htu21_governor_get_duty_limit(const struct htu21_governor *);
+
+/**
+ * \brief Records a conversion issued to the device.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Time the conversion was triggered (us)
+ * \param[in] uint32_t : Conversion time (us)
+ */
+void htu21_governor_record(struct htu21_governor *, int64_t, uint32_t);
+
+/**
+ * \brief Returns the duty cycle over the window ending now.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint16_t - Duty cycle (permille).
+ */
+uint16_t htu21_governor_duty_cycle(const struct htu21_governor *, int64_t);
+
+/**
+ * \brief Returns how long to wait before the next conversion can be triggered
+ *        without exceeding the duty cycle limit.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] int64_t : Current time (us)
+ * \param[in] uint32_t : Conversion time of the planned measurement (us)
+ *
+ * \return uint32_t - Delay before triggering (us), 0 if the trigger is allowed now.
+ */
+uint32_t htu21_governor_next_trigger_delay(const struct htu21_governor *, int64_t, uint32_t);
+
+/**
+ * \brief Returns the shortest sampling period the limit allows in steady state.
+ *        Schedulers should not request samples faster than this.
+ *
+ * \param[in] htu21_governor* : Governor
+ * \param[in] uint32_t : Conversion time of one measurement (us)
+ *
+ * \return uint32_t - Minimum sampling period (us).
+ */
+uint32_t htu21_governor_min_period(const struct htu21_governor *, uint32_t);
+
+#endif /* HTU21_GOVERNOR_H_INCLUDED */
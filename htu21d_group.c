@@ -0,0 +1,159 @@
+/**
+ * \file htu21d_group.c
+ *
+ * \brief HTU21 redundant sensor group source file
+ *
+ */
+
+#include "htu21d_group.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Fuses values, sorted in place : median, or mean without the lowest
+ *        and the highest value.
+ */
+static htu21_real_t htu21_group_fuse(enum htu21_group_fusion fusion, htu21_real_t *values, uint32_t count)
+{
+    htu21_real_t sum = 0;
+    uint32_t i, j;
+
+    // Insertion sort, a handful of members
+    for (i = 1; i < count; i++) {
+        htu21_real_t value = values[i];
+
+        for (j = i; j > 0 && values[j - 1] > value; j--)
+            values[j] = values[j - 1];
+        values[j] = value;
+    }
+
+    if (fusion == htu21_group_median || count < 3)
+        return (count % 2) ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+
+    for (i = 1; i < count - 1; i++)
+        sum += values[i];
+    return sum / (count - 2);
+}
+
+/**
+ * \brief Initializes a group without members, with the default tolerances.
+ *
+ * \param[out] htu21_group* : Group to initialize
+ * \param[in] htu21_group_fusion : Fusion of the agreeing members
+ * \param[in] uint32_t : Agreeing members needed for a reading, 0 for a majority
+ */
+void htu21_group_init(struct htu21_group *group, enum htu21_group_fusion fusion, uint32_t quorum)
+{
+    group->count = 0;
+    group->fusion = fusion;
+    group->quorum = quorum;
+    group->temperature_tolerance = HTU21_GROUP_TEMPERATURE_TOLERANCE;
+    group->humidity_tolerance = HTU21_GROUP_HUMIDITY_TOLERANCE;
+}
+
+/**
+ * \brief Adds a member. Members of one bus are best added in a row.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[in] htu21_device* : Device
+ *
+ * \return bool : false when the group is full
+ */
+bool htu21_group_add(struct htu21_group *group, struct htu21_device *device)
+{
+    if (group->count >= HTU21_GROUP_MAX_MEMBERS)
+        return false;
+
+    group->rejections[group->count] = 0;
+    group->members[group->count++] = device;
+    return true;
+}
+
+/**
+ * \brief Sets the distance to the median beyond which a member is rejected.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[in] htu21_real_t : Temperature tolerance (degC)
+ * \param[in] htu21_real_t : Humidity tolerance (%RH)
+ */
+void htu21_group_set_tolerance(struct htu21_group *group, htu21_real_t temperature_tolerance,
+                               htu21_real_t humidity_tolerance)
+{
+    group->temperature_tolerance = temperature_tolerance;
+    group->humidity_tolerance = humidity_tolerance;
+}
+
+/**
+ * \brief Samples every member together and fuses the agreeing ones.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[out] htu21_group_reading* : Fused reading and vote of the members
+ *
+ * \return bool : true when a quorum of members agree and the reading is valid
+ */
+bool htu21_group_read(struct htu21_group *group, struct htu21_group_reading *reading)
+{
+    htu21_real_t temperature[HTU21_GROUP_MAX_MEMBERS], humidity[HTU21_GROUP_MAX_MEMBERS];
+    htu21_real_t temperature_votes[HTU21_GROUP_MAX_MEMBERS], humidity_votes[HTU21_GROUP_MAX_MEMBERS];
+    htu21_real_t temperature_median, humidity_median;
+    uint32_t quorum = (group->quorum != 0) ? group->quorum : group->count / 2 + 1;
+    uint32_t votes = 0, wait = 0, i;
+
+    reading->agreeing = 0;
+    reading->rejected = 0;
+
+    // One wait for the most restrictive duty-cycle governor of the members
+    for (i = 0; i < group->count; i++) {
+        uint32_t delay = htu21_dev_get_trigger_delay(group->members[i]);
+
+        reading->status[i] = htu21_status_ok;
+        if (delay > wait)
+            wait = delay;
+    }
+    htu21_wait_us(wait);
+
+    htu21_dev_run_measurements(group->members, group->count, temperature, humidity, reading->status);
+
+    for (i = 0; i < group->count; i++) {
+        if (reading->status[i] != htu21_status_ok)
+            continue;
+        temperature_votes[votes] = temperature[i];
+        humidity_votes[votes] = humidity[i];
+        votes++;
+    }
+    if (votes == 0)
+        return false;
+
+    temperature_median = htu21_group_fuse(htu21_group_median, temperature_votes, votes);
+    humidity_median = htu21_group_fuse(htu21_group_median, humidity_votes, votes);
+
+    // Keep the members close to the median on both channels
+    votes = 0;
+    for (i = 0; i < group->count; i++) {
+        if (reading->status[i] != htu21_status_ok)
+            continue;
+        if (HTU21_ABS(temperature[i] - temperature_median) > group->temperature_tolerance
+            || HTU21_ABS(humidity[i] - humidity_median) > group->humidity_tolerance) {
+            reading->rejected |= 1UL << i;
+            group->rejections[i]++;
+            continue;
+        }
+        reading->agreeing |= 1UL << i;
+        temperature_votes[votes] = temperature[i];
+        humidity_votes[votes] = humidity[i];
+        votes++;
+    }
+    if (votes < quorum)
+        return false;
+
+    reading->temperature = htu21_group_fuse(group->fusion, temperature_votes, votes);
+    reading->humidity = htu21_group_fuse(group->fusion, humidity_votes, votes);
+
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
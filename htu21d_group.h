@@ -0,0 +1,102 @@
+/**
+ * \file htu21d_group.h
+ *
+ * \brief HTU21 redundant sensor group header file
+ *
+ * A group fuses redundant sensors of one zone, typically three behind a mux,
+ * into one reading. Each read samples every member together : the
+ * conversions are triggered in one batch per bus and fetched after a single
+ * wait (see htu21_dev_run_measurements), so a group read takes about the wall
+ * time of one sensor read.
+ *
+ * The members that answered are then voted : a member is rejected when its
+ * temperature or its humidity is off the median of the members by more than
+ * the tolerance of the channel. The remaining members are fused by median,
+ * or by mean with the lowest and the highest value dropped. A reading is
+ * published when at least a quorum of members agree, a majority by default.
+ *
+ */
+
+#ifndef HTU21_GROUP_H_INCLUDED
+#define HTU21_GROUP_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+#ifndef HTU21_GROUP_MAX_MEMBERS
+#define HTU21_GROUP_MAX_MEMBERS                                8
+#endif
+
+// Default distance to the median beyond which a member is rejected
+#define HTU21_GROUP_TEMPERATURE_TOLERANCE                    HTU21_REAL(1)    // degC
+#define HTU21_GROUP_HUMIDITY_TOLERANCE                        HTU21_REAL(5)    // %RH
+
+enum htu21_group_fusion {
+    htu21_group_median,
+    htu21_group_trimmed_mean
+};
+
+struct htu21_group {
+    struct htu21_device *members[HTU21_GROUP_MAX_MEMBERS];
+    uint32_t count;
+    enum htu21_group_fusion fusion;
+    // Agreeing members needed for a reading, 0 for a majority
+    uint32_t quorum;
+    htu21_real_t temperature_tolerance;
+    htu21_real_t humidity_tolerance;
+    // Times each member was rejected
+    uint32_t rejections[HTU21_GROUP_MAX_MEMBERS];
+};
+
+struct htu21_group_reading {
+    htu21_real_t temperature;
+    htu21_real_t humidity;
+    // Status of each member
+    enum htu21_status status[HTU21_GROUP_MAX_MEMBERS];
+    // Members fused, and members that answered but were rejected (bit masks)
+    uint32_t agreeing;
+    uint32_t rejected;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a group without members, with the default tolerances.
+ *
+ * \param[out] htu21_group* : Group to initialize
+ * \param[in] htu21_group_fusion : Fusion of the agreeing members
+ * \param[in] uint32_t : Agreeing members needed for a reading, 0 for a majority
+ */
+void htu21_group_init(struct htu21_group *, enum htu21_group_fusion, uint32_t);
+
+/**
+ * \brief Adds a member. Members of one bus are best added in a row.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[in] htu21_device* : Device
+ *
+ * \return bool : false when the group is full
+ */
+bool htu21_group_add(struct htu21_group *, struct htu21_device *);
+
+/**
+ * \brief Sets the distance to the median beyond which a member is rejected.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[in] htu21_real_t : Temperature tolerance (degC)
+ * \param[in] htu21_real_t : Humidity tolerance (%RH)
+ */
+void htu21_group_set_tolerance(struct htu21_group *, htu21_real_t, htu21_real_t);
+
+/**
+ * \brief Samples every member together and fuses the agreeing ones.
+ *
+ * \param[in] htu21_group* : Group
+ * \param[out] htu21_group_reading* : Fused reading and vote of the members
+ *
+ * \return bool : true when a quorum of members agree and the reading is valid
+ */
+bool htu21_group_read(struct htu21_group *, struct htu21_group_reading *);
+
+#endif /* HTU21_GROUP_H_INCLUDED */
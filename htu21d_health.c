@@ -0,0 +1,151 @@
+/**
+ * \file htu21d_health.c
+ *
+ * \brief HTU21 sensor health monitor source file
+ *
+ */
+
+#include "htu21d_health.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Step of the ADCs against full resolution, the coarsest of the two
+static const uint8_t htu21_health_resolution_step[] = {
+    [htu21_resolution_t_14b_rh_12b] = 1,
+    [htu21_resolution_t_12b_rh_8b]  = 16,
+    [htu21_resolution_t_13b_rh_10b] = 4,
+    [htu21_resolution_t_11b_rh_11b] = 8,
+};
+
+/**
+ * \brief Initializes a healthy monitor.
+ *
+ * \param[out] htu21_health* : Monitor to initialize
+ * \param[in] uint32_t : Factor applied to the job period while unhealthy
+ * \param[in] htu21_job_callback : Callback of the application, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_health_init(struct htu21_health *health, uint32_t demotion, htu21_job_callback callback, void *arg)
+{
+    health->demotion = (demotion != 0) ? demotion : 1;
+    health->callback = callback;
+    health->arg = arg;
+    health->temperature = 0;
+    health->humidity = 0;
+    health->repeats = 0;
+    health->flatline_samples = HTU21_HEALTH_FLATLINE_SAMPLES;
+    health->crc_history = 0;
+    health->bus_error_history = 0;
+    health->transfer_errors = 0;
+    health->recovery_failures = 0;
+    health->conditions = 0;
+    health->faults = 0;
+    health->clean_samples = 0;
+    health->demotions = 0;
+}
+
+/**
+ * \brief Scales the flatline count to the resolution of the device.
+ *
+ * \param[in] htu21_health* : Monitor
+ * \param[in] htu21_resolution : Resolution of the device
+ */
+void htu21_health_set_resolution(struct htu21_health *health, enum htu21_resolution resolution)
+{
+    health->flatline_samples = HTU21_HEALTH_FLATLINE_SAMPLES * htu21_health_resolution_step[resolution];
+}
+
+/**
+ * \brief Evaluates one sample.
+ *
+ * \param[in] htu21_health* : Monitor
+ * \param[in] htu21_status : Status of the measurement
+ * \param[in] htu21_real_t : Temperature (degC), when the status is ok
+ * \param[in] htu21_real_t : Relative humidity (%RH), when the status is ok
+ * \param[in] htu21_metrics* : Metrics of the device, NULL when not attached
+ *
+ * \return bool : true while the device is healthy
+ */
+bool htu21_health_update(struct htu21_health *health, enum htu21_status status, htu21_real_t temperature,
+                         htu21_real_t humidity, const struct htu21_metrics *metrics)
+{
+    uint32_t conditions = 0;
+    bool bus_errors = false;
+
+    health->crc_history = (health->crc_history << 1) | (status == htu21_status_crc_error);
+    if (__builtin_popcount(health->crc_history) >= HTU21_HEALTH_CRC_ERRORS)
+        conditions |= HTU21_HEALTH_CRC_STORM;
+
+    if (metrics != NULL) {
+        bus_errors = metrics->transfer_errors != health->transfer_errors
+                     || metrics->bus_recovery_failures != health->recovery_failures;
+        health->transfer_errors = metrics->transfer_errors;
+        health->recovery_failures = metrics->bus_recovery_failures;
+    }
+    health->bus_error_history = (health->bus_error_history << 1) | bus_errors;
+    if (__builtin_popcount(health->bus_error_history) >= HTU21_HEALTH_BUS_ERRORS)
+        conditions |= HTU21_HEALTH_BUS_ERRORS_SEEN;
+
+    if (status == htu21_status_ok) {
+        if (health->repeats != 0 && temperature == health->temperature && humidity == health->humidity) {
+            health->repeats++;
+        } else {
+            health->temperature = temperature;
+            health->humidity = humidity;
+            health->repeats = 1;
+        }
+        if (health->repeats >= health->flatline_samples)
+            conditions |= HTU21_HEALTH_FLATLINE;
+
+        if (temperature < HTU21_HEALTH_TEMPERATURE_MIN || temperature > HTU21_HEALTH_TEMPERATURE_MAX
+            || humidity <= HTU21_HEALTH_HUMIDITY_MIN || humidity >= HTU21_HEALTH_HUMIDITY_MAX)
+            conditions |= HTU21_HEALTH_OUT_OF_RANGE;
+    }
+
+    health->conditions = conditions;
+    if (conditions != 0) {
+        if (health->faults == 0)
+            health->demotions++;
+        health->faults |= conditions;
+        health->clean_samples = 0;
+    } else if (health->faults != 0 && status == htu21_status_ok
+               && ++health->clean_samples >= HTU21_HEALTH_RECOVERY_SAMPLES) {
+        health->faults = 0;
+    }
+
+    return health->faults == 0;
+}
+
+/**
+ * \brief Job callback evaluating each sample of the job, demoting or
+ *        restoring the job, then calling the callback of the application.
+ *
+ * \param[in] htu21_job* : Job
+ * \param[in] htu21_status : Status of the measurement
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ * \param[in] void* : htu21_health*
+ */
+void htu21_health_job_callback(struct htu21_job *job, enum htu21_status status, htu21_real_t temperature,
+                               htu21_real_t humidity, void *arg)
+{
+    struct htu21_health *health = (struct htu21_health *) arg;
+    bool was_healthy = (health->faults == 0);
+    bool healthy;
+
+    htu21_health_set_resolution(health, htu21_dev_get_resolution(job->device));
+    healthy = htu21_health_update(health, status, temperature, humidity,
+                                  __atomic_load_n(&job->device->metrics, __ATOMIC_ACQUIRE));
+
+    if (healthy != was_healthy)
+        htu21_scheduler_demote(job, healthy ? 1 : health->demotion);
+
+    if (health->callback != NULL)
+        health->callback(job, status, temperature, humidity, health->arg);
+}
+
+#ifdef __cplusplus
+}
+#endif
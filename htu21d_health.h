@@ -0,0 +1,152 @@
+/**
+ * \file htu21d_health.h
+ *
+ * \brief HTU21 sensor health monitor header file
+ *
+ * A sensor whose answers pass the CRC check can still be broken. The health
+ * monitor of a device watches its samples as they come, in constant time :
+ *
+ * - flatline : the same temperature and humidity many times in a row, a
+ *   frozen ADC. A working sensor at full resolution never repeats both values
+ *   HTU21_HEALTH_FLATLINE_SAMPLES times. A coarser resolution repeats codes
+ *   more often : the count is scaled by the step of the coarsest of the two
+ *   ADCs against full resolution (x16 at T 12b / RH 8b, see
+ *   htu21_health_set_resolution).
+ * - out of range : a temperature outside the operating range of the sensor,
+ *   or a humidity at a rail of the ADC : code 0x0000 (-6 %RH), or the top
+ *   code of the resolution (118.5 %RH at 8 bits up to 118.99 %RH at 12
+ *   bits). A humidity a little below 0 or above 100 %RH is a valid reading
+ *   near the ends of the range, and is not flagged.
+ * - CRC errors : at least HTU21_HEALTH_CRC_ERRORS of the last 32 samples
+ *   failed the CRC check.
+ * - bus errors : with the metrics of the device attached (see
+ *   htu21d_metrics.h), at least HTU21_HEALTH_BUS_ERRORS of the last 32
+ *   samples saw a failed transfer or a failed bus recovery in the driver
+ *   counters, including the transfers that succeeded on a retry.
+ *
+ * A device is unhealthy as soon as one condition shows, and healthy again
+ * after HTU21_HEALTH_RECOVERY_SAMPLES clean samples in a row. Used as the
+ * callback of a scheduler job, the monitor demotes the job of an unhealthy
+ * device by the given factor (see htu21_scheduler_demote), and restores it
+ * on recovery. It follows the resolution of the device and reads its
+ * metrics. The samples are forwarded to the callback of the application.
+ *
+ */
+
+#ifndef HTU21_HEALTH_H_INCLUDED
+#define HTU21_HEALTH_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+#include "htu21d_metrics.h"
+#include "htu21d_scheduler.h"
+
+// Identical samples in a row flagged as a flatline, at full resolution
+#ifndef HTU21_HEALTH_FLATLINE_SAMPLES
+#define HTU21_HEALTH_FLATLINE_SAMPLES                        64
+#endif
+
+// CRC errors among the last 32 samples flagged as a CRC storm
+#ifndef HTU21_HEALTH_CRC_ERRORS
+#define HTU21_HEALTH_CRC_ERRORS                                4
+#endif
+
+// Samples with driver errors among the last 32 flagged as bus errors
+#ifndef HTU21_HEALTH_BUS_ERRORS
+#define HTU21_HEALTH_BUS_ERRORS                                4
+#endif
+
+// Clean samples in a row before an unhealthy device is healthy again
+#ifndef HTU21_HEALTH_RECOVERY_SAMPLES
+#define HTU21_HEALTH_RECOVERY_SAMPLES                        16
+#endif
+
+// Operating temperature range of the sensor
+#define HTU21_HEALTH_TEMPERATURE_MIN                        HTU21_REAL(-40)
+#define HTU21_HEALTH_TEMPERATURE_MAX                        HTU21_REAL(125)
+// Humidity of the ADC rails at any resolution, flagged at and beyond them
+#define HTU21_HEALTH_HUMIDITY_MIN                            HTU21_REAL(-6)
+#define HTU21_HEALTH_HUMIDITY_MAX                            HTU21_REAL(118.5)
+
+// Conditions, combined in a mask
+#define HTU21_HEALTH_FLATLINE                                0x01
+#define HTU21_HEALTH_OUT_OF_RANGE                            0x02
+#define HTU21_HEALTH_CRC_STORM                                0x04
+#define HTU21_HEALTH_BUS_ERRORS_SEEN                        0x08
+
+struct htu21_health {
+    // Factor applied to the job period while unhealthy, 1 for none
+    uint32_t demotion;
+    // Callback of the application, called after the evaluation
+    htu21_job_callback callback;
+    void *arg;
+    // Last sample and how many times in a row it was seen
+    htu21_real_t temperature;
+    htu21_real_t humidity;
+    uint32_t repeats;
+    // Repeats flagged as a flatline at the resolution of the device
+    uint32_t flatline_samples;
+    // CRC check outcome of the last 32 samples, 1 for an error
+    uint32_t crc_history;
+    // Driver errors of the last 32 samples, 1 when the counters grew, and
+    // the counters last seen
+    uint32_t bus_error_history;
+    uint32_t transfer_errors;
+    uint32_t recovery_failures;
+    // Conditions of the last sample, HTU21_HEALTH_*
+    uint32_t conditions;
+    // Conditions seen since the device became unhealthy, 0 while healthy
+    uint32_t faults;
+    uint32_t clean_samples;
+    // Times the device became unhealthy
+    uint32_t demotions;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a healthy monitor.
+ *
+ * \param[out] htu21_health* : Monitor to initialize
+ * \param[in] uint32_t : Factor applied to the job period while unhealthy
+ * \param[in] htu21_job_callback : Callback of the application, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_health_init(struct htu21_health *, uint32_t, htu21_job_callback, void *);
+
+/**
+ * \brief Scales the flatline count to the resolution of the device.
+ *
+ * \param[in] htu21_health* : Monitor
+ * \param[in] htu21_resolution : Resolution of the device
+ */
+void htu21_health_set_resolution(struct htu21_health *, enum htu21_resolution);
+
+/**
+ * \brief Evaluates one sample.
+ *
+ * \param[in] htu21_health* : Monitor
+ * \param[in] htu21_status : Status of the measurement
+ * \param[in] htu21_real_t : Temperature (degC), when the status is ok
+ * \param[in] htu21_real_t : Relative humidity (%RH), when the status is ok
+ * \param[in] htu21_metrics* : Metrics of the device, NULL when not attached
+ *
+ * \return bool : true while the device is healthy
+ */
+bool htu21_health_update(struct htu21_health *, enum htu21_status, htu21_real_t, htu21_real_t,
+                         const struct htu21_metrics *);
+
+/**
+ * \brief Job callback evaluating each sample of the job, demoting or
+ *        restoring the job, then calling the callback of the application.
+ *
+ * \param[in] htu21_job* : Job
+ * \param[in] htu21_status : Status of the measurement
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ * \param[in] void* : htu21_health*
+ */
+void htu21_health_job_callback(struct htu21_job *, enum htu21_status, htu21_real_t, htu21_real_t, void *);
+
+#endif /* HTU21_HEALTH_H_INCLUDED */
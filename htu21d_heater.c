@@ -0,0 +1,184 @@
+/**
+ * \file htu21d_heater.c
+ *
+ * \brief HTU21 heater controller source file
+ *
+ */
+
+#include "htu21d_heater.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Fills a heater configuration with the default values.
+ *
+ * \param[out] htu21_heater_config* : Configuration
+ */
+void htu21_heater_default_config(struct htu21_heater_config *config)
+{
+    config->pulse_ms = HTU21_HEATER_DEFAULT_PULSE_MS;
+    config->cooldown_ms = HTU21_HEATER_DEFAULT_COOLDOWN_MS;
+    config->saturation_rh = HTU21_HEATER_DEFAULT_SATURATION_RH;
+    config->saturation_ms = HTU21_HEATER_DEFAULT_SATURATION_MS;
+    config->min_interval_ms = HTU21_HEATER_DEFAULT_MIN_INTERVAL_MS;
+}
+
+/**
+ * \brief Initializes a heater controller.
+ *
+ * \param[out] htu21_heater_ctl* : Controller to initialize
+ * \param[in] htu21_device* : Device whose heater is driven
+ * \param[in] htu21_heater_config* : Configuration
+ */
+void htu21_heater_ctl_init(struct htu21_heater_ctl *ctl, struct htu21_device *device,
+                           const struct htu21_heater_config *config)
+{
+    ctl->device = device;
+    ctl->config = *config;
+    ctl->state = htu21_heater_ctl_idle;
+    ctl->state_end_us = 0;
+    ctl->saturated_since_us = 0;
+    ctl->last_pulse_us = 0;
+    ctl->saturated = false;
+    ctl->pulse_requested = false;
+    ctl->pulsed = false;
+    ctl->pulse_count = 0;
+}
+
+/**
+ * \brief Requests a heater pulse. It starts at the next poll once the controller is idle.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ */
+void htu21_heater_ctl_request_pulse(struct htu21_heater_ctl *ctl)
+{
+    ctl->pulse_requested = true;
+}
+
+/**
+ * \brief Advances the controller. Never blocks : at most one heater register
+ *        update is performed per call. On error the transition is retried at
+ *        the next call.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_heater_ctl_poll(struct htu21_heater_ctl *ctl, int64_t now_us)
+{
+    enum htu21_status status = htu21_status_ok;
+
+    switch (ctl->state) {
+    case htu21_heater_ctl_idle:
+        if (!ctl->pulse_requested)
+            break;
+        status = htu21_dev_enable_heater(ctl->device);
+        if (status != htu21_status_ok)
+            break;
+        ctl->pulse_requested = false;
+        ctl->pulsed = true;
+        ctl->pulse_count++;
+        ctl->last_pulse_us = now_us;
+        ctl->state_end_us = now_us + (int64_t) ctl->config.pulse_ms * 1000;
+        ctl->state = htu21_heater_ctl_heating;
+        break;
+
+    case htu21_heater_ctl_heating:
+        if (now_us < ctl->state_end_us)
+            break;
+        status = htu21_dev_disable_heater(ctl->device);
+        if (status != htu21_status_ok)
+            break;
+        ctl->state_end_us = now_us + (int64_t) ctl->config.cooldown_ms * 1000;
+        ctl->state = htu21_heater_ctl_cooldown;
+        break;
+
+    case htu21_heater_ctl_cooldown:
+        if (now_us < ctl->state_end_us)
+            break;
+        // Saturation has to be observed again on valid samples
+        ctl->saturated = false;
+        ctl->state = htu21_heater_ctl_idle;
+        break;
+    }
+
+    return status;
+}
+
+/**
+ * \brief Returns the time left until the controller needs to be polled again.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Time until the next transition (us), UINT32_MAX if none is pending.
+ */
+uint32_t htu21_heater_ctl_next_event(const struct htu21_heater_ctl *ctl, int64_t now_us)
+{
+    if (ctl->state == htu21_heater_ctl_idle)
+        return ctl->pulse_requested ? 0 : UINT32_MAX;
+    if (ctl->state_end_us <= now_us)
+        return 0;
+    return (uint32_t) (ctl->state_end_us - now_us);
+}
+
+/**
+ * \brief Returns the flags of a sample taken now.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Time of the sample (us)
+ *
+ * \return uint8_t - HTU21_SAMPLE_FLAG_xxx mask, 0 if the sample is valid.
+ */
+uint8_t htu21_heater_ctl_sample_flags(const struct htu21_heater_ctl *ctl, int64_t now_us)
+{
+    if (ctl->state == htu21_heater_ctl_heating)
+        return HTU21_SAMPLE_FLAG_HEATER_ON;
+    if (ctl->state == htu21_heater_ctl_cooldown && now_us < ctl->state_end_us)
+        return HTU21_SAMPLE_FLAG_HEATER_COOLDOWN;
+    return 0;
+}
+
+/**
+ * \brief Feeds a sample to the controller.
+ *        Tracks saturation for the automatic condensation recovery.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Time of the sample (us)
+ * \param[in] float : Relative humidity measured (%RH)
+ *
+ * \return uint8_t - HTU21_SAMPLE_FLAG_xxx mask, 0 if the sample is valid.
+ */
+uint8_t htu21_heater_ctl_process_sample(struct htu21_heater_ctl *ctl, int64_t now_us, float relative_humidity)
+{
+    uint8_t flags = htu21_heater_ctl_sample_flags(ctl, now_us);
+
+    if (flags != 0 || ctl->config.saturation_rh <= 0)
+        return flags;
+
+    if (relative_humidity < ctl->config.saturation_rh) {
+        ctl->saturated = false;
+        return flags;
+    }
+
+    if (!ctl->saturated) {
+        ctl->saturated = true;
+        ctl->saturated_since_us = now_us;
+    }
+
+    if (now_us - ctl->saturated_since_us >= (int64_t) ctl->config.saturation_ms * 1000
+        && (!ctl->pulsed || now_us - ctl->last_pulse_us >= (int64_t) ctl->config.min_interval_ms * 1000))
+        ctl->pulse_requested = true;
+
+    return flags;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,145 @@
+/**
+ * \file htu21d_heater.h
+ *
+ * \brief HTU21 heater controller header file
+ *
+ * Non-blocking state machine driving the on-chip heater :
+ *
+ *   idle --(pulse requested)--> heating --(pulse time)--> cooldown --(cooldown time)--> idle
+ *
+ * The application calls htu21_heater_ctl_poll from its sampling loop, the
+ * controller only issues the register writes when a transition is due. Samples
+ * taken while heating or cooling down are flagged so they can be discarded.
+ * A pulse is requested automatically when the relative humidity stays above
+ * the saturation threshold long enough (condensation recovery).
+ *
+ */
+
+#ifndef HTU21_HEATER_H_INCLUDED
+#define HTU21_HEATER_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+// Default heater management timings
+#define HTU21_HEATER_DEFAULT_PULSE_MS                        5000    // ms value
+#define HTU21_HEATER_DEFAULT_COOLDOWN_MS                    10000    // ms value
+#define HTU21_HEATER_DEFAULT_SATURATION_RH                    (float)(98)
+#define HTU21_HEATER_DEFAULT_SATURATION_MS                    60000    // ms value
+#define HTU21_HEATER_DEFAULT_MIN_INTERVAL_MS                300000    // ms value
+
+// Sample flags
+#define HTU21_SAMPLE_FLAG_HEATER_ON                            0x01
+#define HTU21_SAMPLE_FLAG_HEATER_COOLDOWN                    0x02
+
+enum htu21_heater_ctl_state {
+    htu21_heater_ctl_idle,
+    htu21_heater_ctl_heating,
+    htu21_heater_ctl_cooldown
+};
+
+struct htu21_heater_config {
+    // Heater on time (ms)
+    uint32_t pulse_ms;
+    // Time after the heater is switched off before samples are valid again (ms)
+    uint32_t cooldown_ms;
+    // Relative humidity above which the sensor is considered saturated (%RH), 0 disables
+    float saturation_rh;
+    // Time the sensor has to stay saturated before a pulse is requested (ms)
+    uint32_t saturation_ms;
+    // Minimum time between two automatic pulses (ms)
+    uint32_t min_interval_ms;
+};
+
+struct htu21_heater_ctl {
+    // Device whose heater is driven
+    struct htu21_device *device;
+    struct htu21_heater_config config;
+    enum htu21_heater_ctl_state state;
+    // End of the heating or cooldown phase (us)
+    int64_t state_end_us;
+    // Start of the current saturation period (us)
+    int64_t saturated_since_us;
+    // Start of the last pulse (us)
+    int64_t last_pulse_us;
+    bool saturated;
+    bool pulse_requested;
+    bool pulsed;
+    // Number of pulses performed
+    uint32_t pulse_count;
+};
+
+// Functions
+
+/**
+ * \brief Fills a heater configuration with the default values.
+ *
+ * \param[out] htu21_heater_config* : Configuration
+ */
+void htu21_heater_default_config(struct htu21_heater_config *);
+
+/**
+ * \brief Initializes a heater controller.
+ *
+ * \param[out] htu21_heater_ctl* : Controller to initialize
+ * \param[in] htu21_device* : Device whose heater is driven
+ * \param[in] htu21_heater_config* : Configuration
+ */
+void htu21_heater_ctl_init(struct htu21_heater_ctl *, struct htu21_device *, const struct htu21_heater_config *);
+
+/**
+ * \brief Requests a heater pulse. It starts at the next poll once the controller is idle.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ */
+void htu21_heater_ctl_request_pulse(struct htu21_heater_ctl *);
+
+/**
+ * \brief Advances the controller. Never blocks : at most one heater register
+ *        update is performed per call. On error the transition is retried at
+ *        the next call.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return htu21_status : status of HTU21
+ *       - htu21_status_ok : I2C transfer completed successfully
+ *       - htu21_status_i2c_transfer_error : Problem with i2c transfer
+ *       - htu21_status_no_i2c_acknowledge : I2C did not acknowledge
+ */
+enum htu21_status htu21_heater_ctl_poll(struct htu21_heater_ctl *, int64_t);
+
+/**
+ * \brief Returns the time left until the controller needs to be polled again.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Time until the next transition (us), UINT32_MAX if none is pending.
+ */
+uint32_t htu21_heater_ctl_next_event(const struct htu21_heater_ctl *, int64_t);
+
+/**
+ * \brief Returns the flags of a sample taken now.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Time of the sample (us)
+ *
+ * \return uint8_t - HTU21_SAMPLE_FLAG_xxx mask, 0 if the sample is valid.
+ */
+uint8_t htu21_heater_ctl_sample_flags(const struct htu21_heater_ctl *, int64_t);
+
+/**
+ * \brief Feeds a sample to the controller.
+ *        Tracks saturation for the automatic condensation recovery.
+ *
+ * \param[in] htu21_heater_ctl* : Controller
+ * \param[in] int64_t : Time of the sample (us)
+ * \param[in] float : Relative humidity measured (%RH)
+ *
+ * \return uint8_t - HTU21_SAMPLE_FLAG_xxx mask, 0 if the sample is valid.
+ */
+uint8_t htu21_heater_ctl_process_sample(struct htu21_heater_ctl *, int64_t, float);
+
+#endif /* HTU21_HEATER_H_INCLUDED */
@@ -0,0 +1,85 @@
+/**
+ * \file htu21d_lut.c
+ *
+ * \brief HTU21 conversion lookup tables source file
+ *
+ * The tables are expanded by the preprocessor : HTU21_LUT_REPn(F, shift, i)
+ * emits F(shift, i), F(shift, i + 1), ... F(shift, i + n - 1), and F builds
+ * the constant conversion of code i << shift with the same conversion macro
+ * as htu21_read_temperature_and_relative_humidity. The compiler folds every
+ * entry, nothing is computed at run time.
+ *
+ */
+
+#include "htu21d_lut.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(HTU21_LUT_T_12B_RH_8B) || defined(HTU21_LUT_T_13B_RH_10B) \
+    || defined(HTU21_LUT_T_11B_RH_11B)
+
+#define HTU21_LUT_TEMPERATURE(shift, i)                     \
+    HTU21_TEMPERATURE_FROM_ADC((i) << (shift))
+#define HTU21_LUT_HUMIDITY(shift, i)                        HTU21_HUMIDITY_FROM_ADC((i) << (shift))
+#define HTU21_LUT_COMPENSATED_HUMIDITY(shift, i)            \
+    (HTU21_LUT_HUMIDITY(shift, i)                           \
+     + HTU21_REAL_MUL(HTU21_REAL(25), HTU21_TEMPERATURE_COEFFICIENT))
+
+#define HTU21_LUT_REP4(F, s, i)                             F(s, (i)), F(s, (i) + 1), \
+                                                            F(s, (i) + 2), F(s, (i) + 3)
+#define HTU21_LUT_REP16(F, s, i)                            HTU21_LUT_REP4(F, s, (i)),     \
+                                                            HTU21_LUT_REP4(F, s, (i) + 4), \
+                                                            HTU21_LUT_REP4(F, s, (i) + 8), \
+                                                            HTU21_LUT_REP4(F, s, (i) + 12)
+#define HTU21_LUT_REP64(F, s, i)                            HTU21_LUT_REP16(F, s, (i)),      \
+                                                            HTU21_LUT_REP16(F, s, (i) + 16), \
+                                                            HTU21_LUT_REP16(F, s, (i) + 32), \
+                                                            HTU21_LUT_REP16(F, s, (i) + 48)
+#define HTU21_LUT_REP256(F, s, i)                           HTU21_LUT_REP64(F, s, (i)),       \
+                                                            HTU21_LUT_REP64(F, s, (i) + 64),  \
+                                                            HTU21_LUT_REP64(F, s, (i) + 128), \
+                                                            HTU21_LUT_REP64(F, s, (i) + 192)
+#define HTU21_LUT_REP1024(F, s, i)                          HTU21_LUT_REP256(F, s, (i)),       \
+                                                            HTU21_LUT_REP256(F, s, (i) + 256), \
+                                                            HTU21_LUT_REP256(F, s, (i) + 512), \
+                                                            HTU21_LUT_REP256(F, s, (i) + 768)
+#define HTU21_LUT_REP2048(F, s, i)                          HTU21_LUT_REP1024(F, s, (i)), \
+                                                            HTU21_LUT_REP1024(F, s, (i) + 1024)
+
+#endif
+
+#ifdef HTU21_LUT_T_12B_RH_8B
+const htu21_real_t htu21_lut_humidity_8b[1 << 8] = {
+    HTU21_LUT_REP256(HTU21_LUT_HUMIDITY, HTU21_LUT_SHIFT_8B, 0)
+};
+const htu21_real_t htu21_lut_compensated_humidity_8b[1 << 8] = {
+    HTU21_LUT_REP256(HTU21_LUT_COMPENSATED_HUMIDITY, HTU21_LUT_SHIFT_8B, 0)
+};
+#endif
+
+#ifdef HTU21_LUT_T_13B_RH_10B
+const htu21_real_t htu21_lut_humidity_10b[1 << 10] = {
+    HTU21_LUT_REP1024(HTU21_LUT_HUMIDITY, HTU21_LUT_SHIFT_10B, 0)
+};
+const htu21_real_t htu21_lut_compensated_humidity_10b[1 << 10] = {
+    HTU21_LUT_REP1024(HTU21_LUT_COMPENSATED_HUMIDITY, HTU21_LUT_SHIFT_10B, 0)
+};
+#endif
+
+#ifdef HTU21_LUT_T_11B_RH_11B
+const htu21_real_t htu21_lut_temperature_11b[1 << 11] = {
+    HTU21_LUT_REP2048(HTU21_LUT_TEMPERATURE, HTU21_LUT_SHIFT_11B, 0)
+};
+const htu21_real_t htu21_lut_humidity_11b[1 << 11] = {
+    HTU21_LUT_REP2048(HTU21_LUT_HUMIDITY, HTU21_LUT_SHIFT_11B, 0)
+};
+const htu21_real_t htu21_lut_compensated_humidity_11b[1 << 11] = {
+    HTU21_LUT_REP2048(HTU21_LUT_COMPENSATED_HUMIDITY, HTU21_LUT_SHIFT_11B, 0)
+};
+#endif
+
+#ifdef __cplusplus
+}
+#endif
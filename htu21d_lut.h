@@ -0,0 +1,159 @@
+/**
+ * \file htu21d_lut.h
+ *
+ * \brief HTU21 conversion lookup tables header file
+ *
+ * In the low resolution modes an ADC channel only has a few hundred or
+ * thousand distinct codes. For those, the raw to physical conversion is
+ * replaced by a single indexed load from a table generated at compile time
+ * by the preprocessor (see htu21d_lut.c), so no code generator is needed.
+ *
+ * Tables are only emitted for the resolutions the build enables, e.g. in the
+ * component.mk of the application :
+ *
+ *     CFLAGS += -DHTU21_LUT_T_12B_RH_8B      // RH 8 bits  :  2 x 256 entries
+ *     CFLAGS += -DHTU21_LUT_T_13B_RH_10B     // RH 10 bits :  2 x 1024 entries
+ *     CFLAGS += -DHTU21_LUT_T_11B_RH_11B     // T & RH 11 bits : 3 x 2048 entries
+ *
+ * The compensated humidity RH + (25 - T) * coeff is split into a table of
+ * RH + 25 * coeff indexed by the RH code, plus - coeff * T.
+ *
+ * The unused low order bits of the codes, including the two status bits,
+ * are ignored by the lookup, as they are by the run-time conversion of the
+ * driver : both give the same value for every code (see test/).
+ *
+ */
+
+#ifndef HTU21_LUT_H_INCLUDED
+#define HTU21_LUT_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+// Significant bits of the ADC codes in each resolution
+#define HTU21_LUT_SHIFT_8B                                    8
+#define HTU21_LUT_SHIFT_10B                                    6
+#define HTU21_LUT_SHIFT_11B                                    5
+
+#ifdef HTU21_LUT_T_12B_RH_8B
+extern const htu21_real_t htu21_lut_humidity_8b[1 << 8];
+extern const htu21_real_t htu21_lut_compensated_humidity_8b[1 << 8];
+#endif
+#ifdef HTU21_LUT_T_13B_RH_10B
+extern const htu21_real_t htu21_lut_humidity_10b[1 << 10];
+extern const htu21_real_t htu21_lut_compensated_humidity_10b[1 << 10];
+#endif
+#ifdef HTU21_LUT_T_11B_RH_11B
+extern const htu21_real_t htu21_lut_temperature_11b[1 << 11];
+extern const htu21_real_t htu21_lut_humidity_11b[1 << 11];
+extern const htu21_real_t htu21_lut_compensated_humidity_11b[1 << 11];
+#endif
+
+/**
+ * \brief Converts a temperature ADC code through a lookup table.
+ *
+ * \param[in] htu21_resolution : Resolution the code was acquired with
+ * \param[in] uint16_t : Temperature ADC value
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ *
+ * \return bool : true if a table is available for this resolution,
+ *                false if the caller has to compute the value
+ */
+static inline bool htu21_lut_temperature(enum htu21_resolution res, uint16_t adc, htu21_real_t *temperature)
+{
+#ifdef HTU21_LUT_T_11B_RH_11B
+    if (res == htu21_resolution_t_11b_rh_11b) {
+        *temperature = htu21_lut_temperature_11b[adc >> HTU21_LUT_SHIFT_11B];
+        return true;
+    }
+#endif
+    (void) res;
+    (void) adc;
+    (void) temperature;
+    return false;
+}
+
+/**
+ * \brief Converts a relative humidity ADC code through a lookup table.
+ *
+ * \param[in] htu21_resolution : Resolution the code was acquired with
+ * \param[in] uint16_t : Relative humidity ADC value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
+ *
+ * \return bool : true if a table is available for this resolution,
+ *                false if the caller has to compute the value
+ */
+static inline bool htu21_lut_humidity(enum htu21_resolution res, uint16_t adc, htu21_real_t *humidity)
+{
+#ifdef HTU21_LUT_T_12B_RH_8B
+    if (res == htu21_resolution_t_12b_rh_8b) {
+        *humidity = htu21_lut_humidity_8b[adc >> HTU21_LUT_SHIFT_8B];
+        return true;
+    }
+#endif
+#ifdef HTU21_LUT_T_13B_RH_10B
+    if (res == htu21_resolution_t_13b_rh_10b) {
+        *humidity = htu21_lut_humidity_10b[adc >> HTU21_LUT_SHIFT_10B];
+        return true;
+    }
+#endif
+#ifdef HTU21_LUT_T_11B_RH_11B
+    if (res == htu21_resolution_t_11b_rh_11b) {
+        *humidity = htu21_lut_humidity_11b[adc >> HTU21_LUT_SHIFT_11B];
+        return true;
+    }
+#endif
+    (void) res;
+    (void) adc;
+    (void) humidity;
+    return false;
+}
+
+/**
+ * \brief Computes the compensated humidity from the ADC codes through lookup tables.
+ *
+ * \param[in] htu21_resolution : Resolution the codes were acquired with
+ * \param[in] uint16_t : Temperature ADC value
+ * \param[in] uint16_t : Relative humidity ADC value
+ * \param[out] htu21_real_t* : Compensated humidity (%RH)
+ *
+ * \return bool : true if a table is available for this resolution,
+ *                false if the caller has to compute the value
+ */
+static inline bool htu21_lut_compensated_humidity(enum htu21_resolution res, uint16_t temperature_adc,
+                                                  uint16_t humidity_adc, htu21_real_t *humidity)
+{
+    const htu21_real_t *table = NULL;
+    unsigned shift = 0;
+    htu21_real_t temperature;
+
+#ifdef HTU21_LUT_T_12B_RH_8B
+    if (res == htu21_resolution_t_12b_rh_8b) {
+        table = htu21_lut_compensated_humidity_8b;
+        shift = HTU21_LUT_SHIFT_8B;
+    }
+#endif
+#ifdef HTU21_LUT_T_13B_RH_10B
+    if (res == htu21_resolution_t_13b_rh_10b) {
+        table = htu21_lut_compensated_humidity_10b;
+        shift = HTU21_LUT_SHIFT_10B;
+    }
+#endif
+#ifdef HTU21_LUT_T_11B_RH_11B
+    if (res == htu21_resolution_t_11b_rh_11b) {
+        table = htu21_lut_compensated_humidity_11b;
+        shift = HTU21_LUT_SHIFT_11B;
+    }
+#endif
+    if (table == NULL)
+        return false;
+
+    if (!htu21_lut_temperature(res, temperature_adc, &temperature))
+        temperature = HTU21_TEMPERATURE_FROM_ADC(temperature_adc);
+
+    *humidity = table[humidity_adc >> shift] - HTU21_REAL_MUL(temperature, HTU21_TEMPERATURE_COEFFICIENT);
+    return true;
+}
+
+#endif /* HTU21_LUT_H_INCLUDED */
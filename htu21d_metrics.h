@@ -0,0 +1,59 @@
+/**
+ * \file htu21d_metrics.h
+ *
+ * \brief HTU21 device metrics header file
+ *
+ * Counters kept per device once a metrics block is attached with
+ * htu21_dev_set_metrics. Every module that serves the device adds its own
+ * counters here. They are updated by the task serving the device and may be
+ * read at any time, a reader may see a snapshot in the middle of an update.
+ *
+ */
+
+#ifndef HTU21_METRICS_H_INCLUDED
+#define HTU21_METRICS_H_INCLUDED
+
+#include <stdint.h>
+
+struct htu21_metrics {
+    // Scheduler (htu21d_scheduler.h)
+    uint32_t jobs_completed;
+    uint32_t deadline_misses;
+    uint32_t max_lateness_us;
+    // Transfers (htu21d.c), address bytes included
+    uint32_t transfer_bytes;
+    uint64_t transfer_time_us;
+    // Failed transfers (htu21d.c), those retried after a recovery included
+    uint32_t transfer_errors;
+    // Stuck bus recoveries after a failed transfer (htu21d_bus.h)
+    uint32_t bus_recoveries;
+    uint32_t bus_recovery_failures;
+    uint32_t bus_recovery_time_us;
+};
+
+/**
+ * \brief Clears every counter.
+ *
+ * \param[out] htu21_metrics* : Metrics to clear
+ */
+static inline void htu21_metrics_init(struct htu21_metrics *metrics)
+{
+    *metrics = (struct htu21_metrics) { 0 };
+}
+
+/**
+ * \brief Returns the throughput achieved by the transfers with the device,
+ *        the time between transfers excluded.
+ *
+ * \param[in] htu21_metrics* : Metrics
+ *
+ * \return uint32_t - Throughput (bytes/s), 0 before the first transfer.
+ */
+static inline uint32_t htu21_metrics_throughput(const struct htu21_metrics *metrics)
+{
+    if (metrics->transfer_time_us == 0)
+        return 0;
+    return (uint32_t) ((uint64_t) metrics->transfer_bytes * 1000000 / metrics->transfer_time_us);
+}
+
+#endif /* HTU21_METRICS_H_INCLUDED */
@@ -0,0 +1,98 @@
+/**
+ * \file htu21d_mux.c
+ *
+ * \brief HTU21 I2C multiplexer source file
+ *
+ */
+
+#include "htu21d_mux.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Control register values, kept in memory until a batch is submitted
+static const uint8_t htu21_mux_channel_mask[HTU21_MUX_MAX_CHANNELS] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+};
+
+/**
+ * \brief Initializes a mux. Nothing is written to it.
+ *
+ * \param[out] htu21_mux* : Mux to initialize
+ * \param[in] htu21_bus* : Bus of the mux
+ * \param[in] uint8_t : I2C address
+ * \param[in] uint8_t : Number of channels, at most HTU21_MUX_MAX_CHANNELS
+ */
+void htu21_mux_init(struct htu21_mux *mux, struct htu21_bus *bus, uint8_t address, uint8_t channels)
+{
+    mux->bus = bus;
+    mux->address = address;
+    mux->channels = (channels > HTU21_MUX_MAX_CHANNELS) ? HTU21_MUX_MAX_CHANNELS : channels;
+    mux->selected = HTU21_MUX_NONE;
+}
+
+/**
+ * \brief Selects a channel, bus lock held. Writes the mux only when another
+ *        channel is selected.
+ *
+ * \param[in] htu21_mux* : Mux
+ * \param[in] uint8_t : Channel
+ * \param[in] uint32_t : Timeout (us)
+ *
+ * \return esp_err_t : ESP_OK when the channel is selected
+ */
+esp_err_t htu21_mux_select(struct htu21_mux *mux, uint8_t channel, uint32_t timeout_us)
+{
+    esp_err_t err;
+
+    if (channel >= mux->channels)
+        return ESP_ERR_INVALID_ARG;
+    if (mux->selected == channel)
+        return ESP_OK;
+
+    err = mux->bus->ops->write(mux->bus->context, mux->address, &htu21_mux_channel_mask[channel], 1, timeout_us);
+    mux->selected = (err == ESP_OK) ? (int8_t) channel : HTU21_MUX_NONE;
+
+    return err;
+}
+
+/**
+ * \brief Queues the select of a channel in a batch, bus lock held, when
+ *        another channel is selected. The mux is assumed switched from then
+ *        on : htu21_mux_invalidate if the batch fails.
+ *
+ * \param[in] htu21_mux* : Mux
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : Channel
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_mux_batch_select(struct htu21_mux *mux, struct htu21_bus_batch *batch, uint8_t channel)
+{
+    if (channel >= mux->channels)
+        return false;
+    if (mux->selected == channel)
+        return true;
+    if (!htu21_bus_batch_write(batch, mux->address, &htu21_mux_channel_mask[channel], 1))
+        return false;
+    // The channel switches on the stop, not on a repeated start
+    htu21_bus_batch_stop(batch);
+
+    mux->selected = (int8_t) channel;
+    return true;
+}
+
+/**
+ * \brief Forgets the channel selected, after a failed transfer.
+ *
+ * \param[in] htu21_mux* : Mux
+ */
+void htu21_mux_invalidate(struct htu21_mux *mux)
+{
+    mux->selected = HTU21_MUX_NONE;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+/**
+ * \file htu21d_mux.h
+ *
+ * \brief HTU21 I2C multiplexer header file
+ *
+ * The HTU21 has a fixed address, so several sensors on one bus sit behind an
+ * I2C multiplexer (TCA9548A and compatibles) : one sensor per channel, the
+ * channel selected by writing its bit to the control register of the mux.
+ *
+ * A device attached with htu21_dev_set_mux gets its channel selected before
+ * each of its transfers. The mux remembers the channel selected, under the
+ * bus lock, and is only written when the next device is on another channel.
+ * In a batch the selects go in the same transaction as the transfers, each
+ * ended by its own STOP : the TCA9548A only switches channel on a STOP, the
+ * transfers that follow a select chained with a repeated start would still
+ * reach the previous channel. After a failed transfer the selection is
+ * unknown and written again.
+ *
+ * One mux per bus : the channels of a second mux would stay enabled and put
+ * several sensors at the same address.
+ *
+ */
+
+#ifndef HTU21_MUX_H_INCLUDED
+#define HTU21_MUX_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "htu21d_bus.h"
+
+#define HTU21_MUX_DEFAULT_ADDRESS                            0x70
+#define HTU21_MUX_MAX_CHANNELS                                8
+
+// Selection unknown, the next select writes the mux
+#define HTU21_MUX_NONE                                        -1
+
+struct htu21_mux {
+    struct htu21_bus *bus;
+    uint8_t address;
+    uint8_t channels;
+    // Channel currently selected, HTU21_MUX_NONE when unknown. Under the lock.
+    int8_t selected;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a mux. Nothing is written to it.
+ *
+ * \param[out] htu21_mux* : Mux to initialize
+ * \param[in] htu21_bus* : Bus of the mux
+ * \param[in] uint8_t : I2C address
+ * \param[in] uint8_t : Number of channels, at most HTU21_MUX_MAX_CHANNELS
+ */
+void htu21_mux_init(struct htu21_mux *, struct htu21_bus *, uint8_t, uint8_t);
+
+/**
+ * \brief Selects a channel, bus lock held. Writes the mux only when another
+ *        channel is selected.
+ *
+ * \param[in] htu21_mux* : Mux
+ * \param[in] uint8_t : Channel
+ * \param[in] uint32_t : Timeout (us)
+ *
+ * \return esp_err_t : ESP_OK when the channel is selected
+ */
+esp_err_t htu21_mux_select(struct htu21_mux *, uint8_t, uint32_t);
+
+/**
+ * \brief Queues the select of a channel in a batch, bus lock held, when
+ *        another channel is selected. The mux is assumed switched from then
+ *        on : htu21_mux_invalidate if the batch fails.
+ *
+ * \param[in] htu21_mux* : Mux
+ * \param[in] htu21_bus_batch* : Batch
+ * \param[in] uint8_t : Channel
+ *
+ * \return bool : false when the batch is full
+ */
+bool htu21_mux_batch_select(struct htu21_mux *, struct htu21_bus_batch *, uint8_t);
+
+/**
+ * \brief Forgets the channel selected, after a failed transfer.
+ *
+ * \param[in] htu21_mux* : Mux
+ */
+void htu21_mux_invalidate(struct htu21_mux *);
+
+#endif /* HTU21_MUX_H_INCLUDED */
@@ -0,0 +1,109 @@
+/**
+ * \file htu21d_numeric.h
+ *
+ * \brief HTU21 numeric precision policy header file
+ *
+ * Selects at compile time the arithmetic used by every conversion and
+ * derived metric routine of the driver, e.g. in the component.mk of the
+ * application :
+ *
+ *     CFLAGS += -DHTU21_NUMERIC_POLICY=HTU21_NUMERIC_DOUBLE
+ *
+ * - HTU21_NUMERIC_FIXED  : values are int32_t in hundredths of their unit
+ *                          (0.01 degC, 0.01 %RH, 0.01 Pa, ...). ADC codes
+ *                          are converted, compensated, calibrated, voted
+ *                          and tracked for drift with integer arithmetic
+ *                          only. For targets without an FPU.
+ * - HTU21_NUMERIC_FLOAT  : everything in single precision (default, the
+ *                          ESP32 FPU is single precision only).
+ * - HTU21_NUMERIC_DOUBLE : everything in double precision.
+ *
+ * htu21_real_t is the type of the values exchanged with the application :
+ * int32_t with HTU21_NUMERIC_FIXED, float with HTU21_NUMERIC_FLOAT, double
+ * with HTU21_NUMERIC_DOUBLE. HTU21_REAL(x) gives a constant in that type,
+ * HTU21_REAL_TO_FLOAT / HTU21_REAL_FROM_FLOAT convert a value from and to
+ * htu21_float_t, e.g. for the float-only modules (thermal model, heater
+ * controller, condensation detector).
+ *
+ * The transcendental routines (dew point, vapor pressure, derived metrics)
+ * have no integer form : they compute in htu21_float_t, float with
+ * HTU21_NUMERIC_FIXED, and round their results to hundredths.
+ *
+ * Error bounds against an exact double evaluation, over every ADC code and
+ * over -40..125 degC, 1..100 %RH, checked by test/test_htu21d_numeric.c :
+ *
+ *                              FIXED           FLOAT           DOUBLE
+ *     temperature (degC)       0.005           0.00002         1e-12
+ *     humidity (%RH)           0.005           0.00001         1e-12
+ *     dew point (degC)         0.0051          0.0001          1e-9
+ *
+ */
+
+#ifndef HTU21_NUMERIC_H_INCLUDED
+#define HTU21_NUMERIC_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+// Policies
+#define HTU21_NUMERIC_FIXED                                    0
+#define HTU21_NUMERIC_FLOAT                                    1
+#define HTU21_NUMERIC_DOUBLE                                2
+
+#ifndef HTU21_NUMERIC_POLICY
+#define HTU21_NUMERIC_POLICY                                HTU21_NUMERIC_FLOAT
+#endif
+
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_DOUBLE
+typedef double htu21_real_t;
+typedef double htu21_float_t;
+#define HTU21_POW(x, y)                                        pow(x, y)
+#define HTU21_EXP(x)                                        exp(x)
+#define HTU21_LOG10(x)                                        log10(x)
+#define HTU21_SQRT(x)                                        sqrt(x)
+#define HTU21_FABS(x)                                        fabs(x)
+#elif HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FLOAT || HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+typedef int32_t htu21_real_t;
+#else
+typedef float htu21_real_t;
+#endif
+typedef float htu21_float_t;
+#define HTU21_POW(x, y)                                        powf(x, y)
+#define HTU21_EXP(x)                                        expf(x)
+#define HTU21_LOG10(x)                                        log10f(x)
+#define HTU21_SQRT(x)                                        sqrtf(x)
+#define HTU21_FABS(x)                                        fabsf(x)
+#else
+#error "HTU21_NUMERIC_POLICY must be HTU21_NUMERIC_FIXED, HTU21_NUMERIC_FLOAT or HTU21_NUMERIC_DOUBLE"
+#endif
+
+// Constant of the transcendental routines
+#define HTU21_FLOAT(x)                                        ((htu21_float_t) (x))
+
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+// Hundredths per unit
+#define HTU21_REAL_SCALE                                    100
+// Constant in the representation of the policy, folded by the compiler
+#define HTU21_REAL(x)                                       \
+    ((htu21_real_t) ((x) * HTU21_REAL_SCALE + (((x) < 0) ? -0.5 : 0.5)))
+// Product of two values, widened to int64_t and rounded half away from zero
+#define HTU21_REAL_MUL(x, y)                                                \
+    ((htu21_real_t) (((int64_t) (x) * (y)                                   \
+                      + (((int64_t) (x) * (y) < 0) ? -HTU21_REAL_SCALE / 2  \
+                                                   : HTU21_REAL_SCALE / 2)) \
+                     / HTU21_REAL_SCALE))
+#define HTU21_REAL_TO_FLOAT(x)                                ((htu21_float_t) (x) / HTU21_REAL_SCALE)
+#define HTU21_REAL_FROM_FLOAT(x)                            ((htu21_real_t) lroundf((x) * HTU21_REAL_SCALE))
+#define HTU21_ABS(x)                                        abs(x)
+#else
+#define HTU21_REAL_SCALE                                    1
+#define HTU21_REAL(x)                                        ((htu21_real_t) (x))
+#define HTU21_REAL_MUL(x, y)                                ((x) * (y))
+#define HTU21_REAL_TO_FLOAT(x)                                (x)
+#define HTU21_REAL_FROM_FLOAT(x)                            (x)
+#define HTU21_ABS(x)                                        HTU21_FABS(x)
+#endif
+
+#endif /* HTU21_NUMERIC_H_INCLUDED */
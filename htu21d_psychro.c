@@ -0,0 +1,109 @@
+/**
+ * \file htu21d_psychro.c
+ *
+ * \brief HTU21 incremental psychrometrics source file
+ *
+ */
+
+#include <math.h>
+#include "htu21d.h"
+#include "htu21d_psychro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTU21_PSYCHRO_LN10                                    HTU21_FLOAT(2.302585093)
+
+/**
+ * \brief Recomputes the cached saturation vapor pressure if the temperature
+ *        left the quantum, and returns its first order extrapolation.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ *
+ * \return htu21_float_t - Saturation vapor pressure (Pa).
+ */
+static htu21_float_t htu21_psychro_refresh(struct htu21_psychro *ctx, htu21_real_t temperature)
+{
+    htu21_real_t delta = temperature - ctx->temperature;
+
+    if (!ctx->valid || HTU21_ABS(delta) >= ctx->temperature_quantum) {
+        htu21_float_t denominator = HTU21_REAL_TO_FLOAT(temperature) + HTU21_CONSTANT_C;
+
+        ctx->temperature = temperature;
+        ctx->saturation_pressure = HTU21_POW(10, HTU21_CONSTANT_A - HTU21_CONSTANT_B / denominator)
+                                   * HTU21_PSYCHRO_PA_PER_MMHG;
+        ctx->saturation_slope = HTU21_PSYCHRO_LN10 * HTU21_CONSTANT_B / (denominator * denominator);
+        ctx->valid = true;
+        ctx->refreshes++;
+        return ctx->saturation_pressure;
+    }
+
+    return ctx->saturation_pressure * (1 + ctx->saturation_slope * HTU21_REAL_TO_FLOAT(delta));
+}
+
+/**
+ * \brief Initializes a psychrometrics context.
+ *
+ * \param[out] htu21_psychro* : Context to initialize
+ * \param[in] htu21_real_t : Temperature quantum (degC)
+ */
+void htu21_psychro_init(struct htu21_psychro *ctx, htu21_real_t temperature_quantum)
+{
+    ctx->temperature_quantum = temperature_quantum;
+    ctx->temperature = 0;
+    ctx->saturation_pressure = 0;
+    ctx->saturation_slope = 0;
+    ctx->valid = false;
+    ctx->refreshes = 0;
+}
+
+/**
+ * \brief Returns the saturation vapor pressure.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ *
+ * \return htu21_real_t - Saturation vapor pressure (Pa).
+ */
+htu21_real_t htu21_psychro_saturation_vapor_pressure(struct htu21_psychro *ctx, htu21_real_t temperature)
+{
+    return HTU21_REAL_FROM_FLOAT(htu21_psychro_refresh(ctx, temperature));
+}
+
+/**
+ * \brief Returns the partial pressure of water vapor.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ *
+ * \return htu21_real_t - Vapor pressure (Pa).
+ */
+htu21_real_t htu21_psychro_vapor_pressure(struct htu21_psychro *ctx, htu21_real_t temperature,
+                                          htu21_real_t relative_humidity)
+{
+    return HTU21_REAL_FROM_FLOAT(htu21_psychro_refresh(ctx, temperature) * HTU21_REAL_TO_FLOAT(relative_humidity) / 100);
+}
+
+/**
+ * \brief Returns the dew point. Same result as htu21_compute_dew_point.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (degC).
+ */
+htu21_real_t htu21_psychro_dew_point(struct htu21_psychro *ctx, htu21_real_t temperature,
+                                     htu21_real_t relative_humidity)
+{
+    // Only B/(T+C) is needed here, which is cheaper to compute than to cache
+    (void) ctx;
+    return htu21_compute_dew_point_fast(temperature, relative_humidity);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,86 @@
+/**
+ * \file htu21d_psychro.h
+ *
+ * \brief HTU21 incremental psychrometrics header file
+ *
+ * The saturation vapor pressure 10^(A - B/(T+C)) only depends on the
+ * temperature, which moves much more slowly than the relative humidity.
+ * A psychrometrics context keeps it for the last temperature and only
+ * recomputes the pow when the temperature moves by more than a quantum.
+ * In between, the cached value is extrapolated to first order with its
+ * cached logarithmic derivative, so the quantum adds a second-order error only.
+ *
+ * Per sample cost : one log10 for the dew point, a multiply-add for the
+ * vapor pressures.
+ *
+ */
+
+#ifndef HTU21_PSYCHRO_H_INCLUDED
+#define HTU21_PSYCHRO_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d_numeric.h"
+
+#define HTU21_PSYCHRO_DEFAULT_TEMPERATURE_QUANTUM            HTU21_REAL(0.5)    // degC
+
+// Datasheet partial pressure is in mmHg
+#define HTU21_PSYCHRO_PA_PER_MMHG                            HTU21_FLOAT(133.322)
+
+struct htu21_psychro {
+    // Temperature change that triggers a recomputation (degC)
+    htu21_real_t temperature_quantum;
+    // Temperature the cache was computed at (degC)
+    htu21_real_t temperature;
+    // Saturation vapor pressure at that temperature (Pa)
+    htu21_float_t saturation_pressure;
+    // d(ln Psat)/dT at that temperature (1/degC)
+    htu21_float_t saturation_slope;
+    bool valid;
+    // Number of cache refreshes
+    uint32_t refreshes;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a psychrometrics context.
+ *
+ * \param[out] htu21_psychro* : Context to initialize
+ * \param[in] htu21_real_t : Temperature quantum (degC)
+ */
+void htu21_psychro_init(struct htu21_psychro *, htu21_real_t);
+
+/**
+ * \brief Returns the saturation vapor pressure.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ *
+ * \return htu21_real_t - Saturation vapor pressure (Pa).
+ */
+htu21_real_t htu21_psychro_saturation_vapor_pressure(struct htu21_psychro *, htu21_real_t);
+
+/**
+ * \brief Returns the partial pressure of water vapor.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ *
+ * \return htu21_real_t - Vapor pressure (Pa).
+ */
+htu21_real_t htu21_psychro_vapor_pressure(struct htu21_psychro *, htu21_real_t, htu21_real_t);
+
+/**
+ * \brief Returns the dew point. Same result as htu21_compute_dew_point.
+ *
+ * \param[in] htu21_psychro* : Context
+ * \param[in] htu21_real_t : Temperature (degC)
+ * \param[in] htu21_real_t : Relative humidity (%RH)
+ *
+ * \return htu21_real_t - Dew point temperature (degC).
+ */
+htu21_real_t htu21_psychro_dew_point(struct htu21_psychro *, htu21_real_t, htu21_real_t);
+
+#endif /* HTU21_PSYCHRO_H_INCLUDED */
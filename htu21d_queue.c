@@ -0,0 +1,294 @@
+/**
+ * \file htu21d_queue.c
+ *
+ * \brief HTU21 measurement request queue source file
+ *
+ */
+
+#include "esp_timer.h"
+#include "htu21d_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compile-time check : the ring is indexed with a mask
+typedef char htu21_queue_capacity_check[((HTU21_QUEUE_CAPACITY & (HTU21_QUEUE_CAPACITY - 1)) == 0) ? 1 : -1];
+
+/**
+ * \brief Puts a device in the ring.
+ *
+ * \return bool : false when the ring is full
+ */
+static bool htu21_queue_push(struct htu21_queue *queue, struct htu21_device *device)
+{
+    uint32_t position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+    struct htu21_queue_cell *cell;
+
+    for (;;) {
+        int32_t diff;
+
+        cell = &queue->cells[position & (HTU21_QUEUE_CAPACITY - 1)];
+        diff = (int32_t) (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->device = device;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * \brief Takes the oldest device out of the ring.
+ *
+ * \return bool : false when the ring is empty
+ */
+static bool htu21_queue_pop(struct htu21_queue *queue, struct htu21_device **device)
+{
+    uint32_t position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+    struct htu21_queue_cell *cell;
+
+    for (;;) {
+        int32_t diff;
+
+        cell = &queue->cells[position & (HTU21_QUEUE_CAPACITY - 1)];
+        diff = (int32_t) (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (position + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+        }
+    }
+
+    *device = cell->device;
+    __atomic_store_n(&cell->sequence, position + HTU21_QUEUE_CAPACITY, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void htu21_queue_wait_until(int64_t deadline_us)
+{
+    int64_t wait = deadline_us - esp_timer_get_time();
+
+    if (wait > 0)
+        htu21_wait_us((uint32_t) wait);
+}
+
+static void htu21_queue_submit_notify(struct htu21_queue *queue, struct htu21_request *request,
+                                      struct htu21_device *device, htu21_request_callback callback, void *arg,
+                                      TaskHandle_t notify)
+{
+    struct htu21_request *head;
+    TaskHandle_t worker;
+
+    request->device = device;
+    request->callback = callback;
+    request->arg = arg;
+    request->notify = notify;
+    request->status = htu21_status_ok;
+    request->done = 0;
+
+    head = __atomic_load_n(&device->waiters, __ATOMIC_RELAXED);
+    do {
+        request->next = head;
+    } while (!__atomic_compare_exchange_n(&device->waiters, &head, request, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    // Device already pending : the request shares its next measurement
+    if (head != NULL)
+        return;
+
+    // Only full when more devices than HTU21_QUEUE_CAPACITY are served
+    while (!htu21_queue_push(queue, device))
+        vTaskDelay(1);
+
+    worker = __atomic_load_n(&queue->worker, __ATOMIC_ACQUIRE);
+    if (worker != NULL)
+        xTaskNotifyGive(worker);
+}
+
+/**
+ * \brief Completes every request pending on the device, including the ones
+ *        that joined during the measurement.
+ *
+ * \return uint32_t - Number of requests completed.
+ */
+static uint32_t htu21_queue_complete(struct htu21_device *device, enum htu21_status status,
+                                     htu21_real_t temperature, htu21_real_t humidity)
+{
+    struct htu21_request *request = __atomic_exchange_n(&device->waiters, NULL, __ATOMIC_ACQ_REL);
+    uint32_t count = 0;
+
+    while (request != NULL) {
+        // The owner may reuse the request as soon as it is done or its
+        // callback returned : nothing is read from it afterwards
+        struct htu21_request *next = request->next;
+        TaskHandle_t notify = request->notify;
+        htu21_request_callback callback = request->callback;
+        void *arg = request->arg;
+
+        request->status = status;
+        request->temperature = temperature;
+        request->humidity = humidity;
+        __atomic_store_n(&request->done, 1, __ATOMIC_RELEASE);
+        if (notify != NULL)
+            xTaskNotifyGive(notify);
+        if (callback != NULL)
+            callback(request, arg);
+
+        request = next;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * \brief Initializes a request queue.
+ *
+ * \param[out] htu21_queue* : Queue to initialize
+ */
+void htu21_queue_init(struct htu21_queue *queue)
+{
+    uint32_t i;
+
+    for (i = 0; i < HTU21_QUEUE_CAPACITY; i++) {
+        queue->cells[i].sequence = i;
+        queue->cells[i].device = NULL;
+    }
+    queue->enqueue_position = 0;
+    queue->dequeue_position = 0;
+    queue->worker = NULL;
+    queue->measurements = 0;
+    queue->completions = 0;
+}
+
+/**
+ * \brief Submits a measurement request. Does not block. Joins the pending
+ *        measurement of the device if there is one.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] htu21_request* : Request, owned by the caller until done
+ * \param[in] htu21_device* : Device to measure
+ * \param[in] htu21_request_callback : Completion callback, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_queue_submit(struct htu21_queue *queue, struct htu21_request *request, struct htu21_device *device,
+                        htu21_request_callback callback, void *arg)
+{
+    htu21_queue_submit_notify(queue, request, device, callback, arg, NULL);
+}
+
+/**
+ * \brief Tells whether a request is done. Its results are then valid.
+ *
+ * \param[in] htu21_request* : Request
+ *
+ * \return bool : true when done
+ */
+bool htu21_request_done(const struct htu21_request *request)
+{
+    return __atomic_load_n(&request->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * \brief Submits a measurement request and blocks until it is done.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] htu21_device* : Device to measure
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
+ *
+ * \return htu21_status : status of the measurement
+ */
+enum htu21_status htu21_queue_read(struct htu21_queue *queue, struct htu21_device *device,
+                                   htu21_real_t *temperature, htu21_real_t *humidity)
+{
+    struct htu21_request request;
+
+    htu21_queue_submit_notify(queue, &request, device, NULL, NULL, xTaskGetCurrentTaskHandle());
+    while (!htu21_request_done(&request))
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (request.status == htu21_status_ok) {
+        *temperature = request.temperature;
+        *humidity = request.humidity;
+    }
+    return request.status;
+}
+
+/**
+ * \brief Serves the pending requests, one batch after the other. To be called
+ *        in a loop by the worker task of the bus.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] TickType_t : Time to wait for a request when none is pending
+ *
+ * \return uint32_t - Number of devices measured.
+ */
+uint32_t htu21_queue_process(struct htu21_queue *queue, TickType_t timeout)
+{
+    struct htu21_device *devices[HTU21_QUEUE_BATCH];
+    enum htu21_status status[HTU21_QUEUE_BATCH];
+    htu21_real_t temperature[HTU21_QUEUE_BATCH];
+    htu21_real_t humidity[HTU21_QUEUE_BATCH];
+    uint32_t count = 0, wait = 0, i;
+
+    __atomic_store_n(&queue->worker, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+
+    while (count < HTU21_QUEUE_BATCH && htu21_queue_pop(queue, &devices[count]))
+        count++;
+    if (count == 0) {
+        ulTaskNotifyTake(pdTRUE, timeout);
+        while (count < HTU21_QUEUE_BATCH && htu21_queue_pop(queue, &devices[count]))
+            count++;
+        if (count == 0)
+            return 0;
+    }
+
+    // One wait for the most restrictive duty-cycle governor of the batch
+    for (i = 0; i < count; i++) {
+        uint32_t delay = htu21_dev_get_trigger_delay(devices[i]);
+
+        status[i] = htu21_status_ok;
+        if (delay > wait)
+            wait = delay;
+    }
+    htu21_queue_wait_until(esp_timer_get_time() + wait);
+
+    htu21_dev_run_measurements(devices, count, temperature, humidity, status);
+
+    for (i = 0; i < count; i++)
+        queue->completions += htu21_queue_complete(devices[i], status[i], temperature[i], humidity[i]);
+    queue->measurements += count;
+
+    return count;
+}
+
+/**
+ * \brief Worker task body : serves the queue forever.
+ *
+ * \param[in] void* : htu21_queue*
+ */
+void htu21_queue_task(void *arg)
+{
+    struct htu21_queue *queue = (struct htu21_queue *) arg;
+
+    for (;;)
+        htu21_queue_process(queue, portMAX_DELAY);
+}
+
+#ifdef __cplusplus
+}
+#endif
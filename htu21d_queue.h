@@ -0,0 +1,147 @@
+/**
+ * \file htu21d_queue.h
+ *
+ * \brief HTU21 measurement request queue header file
+ *
+ * Lets many tasks request readings of many devices without blocking on the
+ * bus each. A task submits a request, the worker of the bus serves it and
+ * completes it through a callback, a done flag that can be polled, or both.
+ *
+ * Submission is lock-free :
+ * - the requests of one device are pushed on a lock-free stack held by the
+ *   device. Requests submitted while the device is already pending share the
+ *   next measurement of the device instead of queuing a new one.
+ * - the first request of a device puts the device in a bounded
+ *   multi-producer multi-consumer ring (Vyukov). A device is never twice in
+ *   the ring, so a ring at least as large as the number of devices served
+ *   never overflows.
+ *
+ * The worker takes up to HTU21_QUEUE_BATCH devices at once and pipelines
+ * them : triggers every temperature, waits once for the slowest, fetches
+ * every result, then the same for the humidity. Si70xx devices skip the
+ * temperature conversion and read the temperature of their humidity
+ * conversion back. The triggers of the devices of one bus go in one bus
+ * transaction, and so do the fetches. The bus is free during the waits (see
+ * htu21d_bus.h).
+ *
+ * Requests and queue are owned by the caller. A request must stay valid
+ * until it is done and, when it has a callback, until the callback returned.
+ *
+ */
+
+#ifndef HTU21_QUEUE_H_INCLUDED
+#define HTU21_QUEUE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "htu21d.h"
+
+// Ring size, power of two, at least the number of devices served
+#ifndef HTU21_QUEUE_CAPACITY
+#define HTU21_QUEUE_CAPACITY                                16
+#endif
+
+// Devices measured together by the worker
+#ifndef HTU21_QUEUE_BATCH
+#define HTU21_QUEUE_BATCH                                    4
+#endif
+
+struct htu21_request;
+
+// Called by the worker task once the request is done, last use of the request
+typedef void (*htu21_request_callback)(struct htu21_request *, void *);
+
+struct htu21_request {
+    // Filled by htu21_queue_submit
+    struct htu21_device *device;
+    htu21_request_callback callback;
+    void *arg;
+    TaskHandle_t notify;
+    struct htu21_request *next;
+    // Filled by the worker before done is set
+    enum htu21_status status;
+    htu21_real_t temperature;
+    htu21_real_t humidity;
+    uint32_t done;
+};
+
+struct htu21_queue_cell {
+    uint32_t sequence;
+    struct htu21_device *device;
+};
+
+struct htu21_queue {
+    struct htu21_queue_cell cells[HTU21_QUEUE_CAPACITY];
+    uint32_t enqueue_position;
+    uint32_t dequeue_position;
+    // Task running htu21_queue_process, notified on submission
+    TaskHandle_t worker;
+    // Measurements performed and requests completed
+    uint32_t measurements;
+    uint32_t completions;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a request queue.
+ *
+ * \param[out] htu21_queue* : Queue to initialize
+ */
+void htu21_queue_init(struct htu21_queue *);
+
+/**
+ * \brief Submits a measurement request. Does not block. Joins the pending
+ *        measurement of the device if there is one.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] htu21_request* : Request, owned by the caller until done
+ * \param[in] htu21_device* : Device to measure
+ * \param[in] htu21_request_callback : Completion callback, may be NULL
+ * \param[in] void* : Argument of the callback
+ */
+void htu21_queue_submit(struct htu21_queue *, struct htu21_request *, struct htu21_device *,
+                        htu21_request_callback, void *);
+
+/**
+ * \brief Tells whether a request is done. Its results are then valid.
+ *
+ * \param[in] htu21_request* : Request
+ *
+ * \return bool : true when done
+ */
+bool htu21_request_done(const struct htu21_request *);
+
+/**
+ * \brief Submits a measurement request and blocks until it is done.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] htu21_device* : Device to measure
+ * \param[out] htu21_real_t* : Celsius Degree temperature value
+ * \param[out] htu21_real_t* : %RH Relative Humidity value
+ *
+ * \return htu21_status : status of the measurement
+ */
+enum htu21_status htu21_queue_read(struct htu21_queue *, struct htu21_device *, htu21_real_t *, htu21_real_t *);
+
+/**
+ * \brief Serves the pending requests, one batch after the other. To be called
+ *        in a loop by the worker task of the bus.
+ *
+ * \param[in] htu21_queue* : Queue
+ * \param[in] TickType_t : Time to wait for a request when none is pending
+ *
+ * \return uint32_t - Number of devices measured.
+ */
+uint32_t htu21_queue_process(struct htu21_queue *, TickType_t);
+
+/**
+ * \brief Worker task body : serves the queue forever.
+ *
+ * \param[in] void* : htu21_queue*
+ */
+void htu21_queue_task(void *);
+
+#endif /* HTU21_QUEUE_H_INCLUDED */
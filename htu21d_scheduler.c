@@ -0,0 +1,328 @@
+/**
+ * \file htu21d_scheduler.c
+ *
+ * \brief HTU21 earliest-deadline-first measurement scheduler source file
+ *
+ */
+
+#include "esp_timer.h"
+#include "htu21d_governor.h"
+#include "htu21d_metrics.h"
+#include "htu21d_scheduler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest sleep of the scheduler task, so that added jobs are picked up (us)
+#define HTU21_SCHEDULER_IDLE_US                                1000000
+
+/**
+ * \brief Returns the time a run of the job started now holds the scheduler
+ *        task : transfers, conversions, and the wait the governor of the
+ *        device imposes before the trigger.
+ */
+static inline uint32_t htu21_scheduler_cost(const struct htu21_job *job)
+{
+    return htu21_dev_get_measurement_time(job->device) + HTU21_SCHEDULER_TRANSFER_US
+           + htu21_dev_get_trigger_delay(job->device);
+}
+
+/**
+ * \brief Returns the time each run of the job holds the scheduler task in
+ *        steady state. A period shorter than the governor allows is padded
+ *        by a wait of the difference on every run.
+ */
+static uint32_t htu21_scheduler_steady_cost(const struct htu21_job *job)
+{
+    struct htu21_governor *governor = __atomic_load_n(&job->device->governor, __ATOMIC_ACQUIRE);
+    uint32_t measurement_time = htu21_dev_get_measurement_time(job->device);
+    uint32_t cost = measurement_time + HTU21_SCHEDULER_TRANSFER_US;
+    uint32_t min_period;
+
+    if (governor == NULL)
+        return cost;
+    min_period = htu21_governor_min_period(governor, measurement_time);
+    return (min_period > job->period_us) ? cost + (min_period - job->period_us) : cost;
+}
+
+static void htu21_scheduler_count_miss(struct htu21_job *job, uint32_t count, uint32_t lateness_us)
+{
+    struct htu21_metrics *metrics = __atomic_load_n(&job->device->metrics, __ATOMIC_ACQUIRE);
+
+    job->misses += count;
+    if (lateness_us > job->max_lateness_us)
+        job->max_lateness_us = lateness_us;
+    if (metrics != NULL) {
+        metrics->deadline_misses += count;
+        if (lateness_us > metrics->max_lateness_us)
+            metrics->max_lateness_us = lateness_us;
+    }
+}
+
+/**
+ * \brief Idles until the given time, or lets the idle hook use it.
+ *
+ * \return uint32_t - Wait before the next run (us), 0 when the hook ran.
+ */
+static uint32_t htu21_scheduler_idle(struct htu21_scheduler *scheduler, int64_t now_us, int64_t until_us)
+{
+    uint32_t idle = (uint32_t) (until_us - now_us);
+
+    if (scheduler->idle_hook != NULL && scheduler->idle_hook(scheduler->idle_arg, now_us, idle))
+        return 0;
+    return idle;
+}
+
+/**
+ * \brief Drops the instances of a job whose whole period elapsed without it
+ *        running, and counts them as missed.
+ */
+static void htu21_scheduler_skip_elapsed(struct htu21_job *job, int64_t now_us)
+{
+    uint32_t skipped;
+
+    if (now_us < job->release_us + job->period_us)
+        return;
+
+    skipped = (uint32_t) ((now_us - job->release_us) / job->period_us);
+    htu21_scheduler_count_miss(job, skipped, (now_us > job->absolute_deadline_us)
+                                             ? (uint32_t) (now_us - job->absolute_deadline_us) : 0);
+    job->release_us += (int64_t) skipped * job->period_us;
+    job->absolute_deadline_us = job->release_us + job->deadline_us;
+}
+
+/**
+ * \brief Applies the demotion factor of a job between two of its instances :
+ *        the next release moves from one old period to one new period after
+ *        the last one, and not before now, since the shorter periods that
+ *        already elapsed were not due.
+ */
+static void htu21_scheduler_apply_demotion(struct htu21_job *job, int64_t now_us)
+{
+    uint64_t period = (uint64_t) job->nominal_period_us * job->factor;
+    uint64_t deadline = (uint64_t) job->nominal_deadline_us * job->factor;
+
+    if (period > UINT32_MAX)
+        period = UINT32_MAX;
+    if (deadline > UINT32_MAX)
+        deadline = UINT32_MAX;
+    if (period == job->period_us && deadline == job->deadline_us)
+        return;
+
+    job->release_us -= job->period_us;
+    job->period_us = (uint32_t) period;
+    job->deadline_us = (uint32_t) deadline;
+    job->release_us += job->period_us;
+    if (job->release_us < now_us)
+        job->release_us = now_us;
+    job->absolute_deadline_us = job->release_us + job->deadline_us;
+}
+
+/**
+ * \brief Initializes a scheduler without jobs.
+ *
+ * \param[out] htu21_scheduler* : Scheduler to initialize
+ */
+void htu21_scheduler_init(struct htu21_scheduler *scheduler)
+{
+    scheduler->count = 0;
+    scheduler->idle_hook = NULL;
+    scheduler->idle_arg = NULL;
+}
+
+/**
+ * \brief Adds a periodic job, first released at the given time.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_job* : Job, owned by the caller while scheduled
+ * \param[in] htu21_device* : Device measured by the job
+ * \param[in] uint32_t : Period (ms)
+ * \param[in] uint32_t : Relative deadline (ms), 0 for the period
+ * \param[in] int64_t : First release (us)
+ * \param[in] htu21_job_callback : Called after each run, may be NULL
+ * \param[in] void* : Argument of the callback
+ *
+ * \return bool : false when the scheduler is full, the period is 0, or the
+ *                period or the deadline is above HTU21_SCHEDULER_MAX_PERIOD_MS
+ */
+bool htu21_scheduler_add(struct htu21_scheduler *scheduler, struct htu21_job *job, struct htu21_device *device,
+                         uint32_t period_ms, uint32_t deadline_ms, int64_t release_us,
+                         htu21_job_callback callback, void *arg)
+{
+    if (scheduler->count >= HTU21_SCHEDULER_MAX_JOBS || period_ms == 0
+        || period_ms > HTU21_SCHEDULER_MAX_PERIOD_MS || deadline_ms > HTU21_SCHEDULER_MAX_PERIOD_MS)
+        return false;
+
+    job->device = device;
+    job->period_us = period_ms * 1000;
+    job->deadline_us = (deadline_ms != 0) ? deadline_ms * 1000 : job->period_us;
+    job->nominal_period_us = job->period_us;
+    job->nominal_deadline_us = job->deadline_us;
+    job->factor = 1;
+    job->callback = callback;
+    job->arg = arg;
+    job->release_us = release_us;
+    job->absolute_deadline_us = release_us + job->deadline_us;
+    job->completions = 0;
+    job->misses = 0;
+    job->max_lateness_us = 0;
+
+    scheduler->jobs[scheduler->count++] = job;
+    return true;
+}
+
+/**
+ * \brief Removes a job.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_job* : Job
+ */
+void htu21_scheduler_remove(struct htu21_scheduler *scheduler, struct htu21_job *job)
+{
+    uint32_t i;
+
+    for (i = 0; i < scheduler->count; i++) {
+        if (scheduler->jobs[i] == job) {
+            scheduler->jobs[i] = scheduler->jobs[--scheduler->count];
+            return;
+        }
+    }
+}
+
+/**
+ * \brief Stretches the period and deadline of a job by a factor. A factor of
+ *        1 restores them. The scheduler applies it between two instances of
+ *        the job : an instance already released still runs, and the factor
+ *        counts from the release that follows it. From the scheduler task
+ *        (job callback or idle hook).
+ *
+ * \param[in] htu21_job* : Job
+ * \param[in] uint32_t : Factor, at least 1
+ */
+void htu21_scheduler_demote(struct htu21_job *job, uint32_t factor)
+{
+    job->factor = (factor != 0) ? factor : 1;
+}
+
+/**
+ * \brief Sets the hook run in the idle time of the scheduler. It may add and
+ *        remove jobs.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_scheduler_idle_hook : Hook, NULL for none
+ * \param[in] void* : Argument of the hook
+ */
+void htu21_scheduler_set_idle_hook(struct htu21_scheduler *scheduler, htu21_scheduler_idle_hook hook, void *arg)
+{
+    scheduler->idle_hook = hook;
+    scheduler->idle_arg = arg;
+}
+
+/**
+ * \brief Returns the bus utilization of the jobs, sum of cost / period,
+ *        the cost including the governor waits of a period too short for
+ *        the duty cycle limit. Above 1000 permille the deadlines cannot all
+ *        be met.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ *
+ * \return uint32_t - Utilization (permille).
+ */
+uint32_t htu21_scheduler_utilization(const struct htu21_scheduler *scheduler)
+{
+    uint32_t utilization = 0;
+    uint32_t i;
+
+    for (i = 0; i < scheduler->count; i++)
+        utilization += (uint32_t) ((uint64_t) htu21_scheduler_steady_cost(scheduler->jobs[i]) * 1000
+                                   / scheduler->jobs[i]->period_us);
+
+    return utilization;
+}
+
+/**
+ * \brief Runs at most one job.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Time until the scheduler needs to run again (us).
+ */
+uint32_t htu21_scheduler_run_once(struct htu21_scheduler *scheduler, int64_t now_us)
+{
+    struct htu21_job *job = NULL;
+    int64_t next_release_us = now_us + HTU21_SCHEDULER_IDLE_US;
+    enum htu21_status status;
+    htu21_real_t temperature = 0, humidity = 0;
+    struct htu21_metrics *metrics;
+    uint32_t cost, i;
+    int64_t end_us;
+
+    // Earliest deadline among the released jobs
+    for (i = 0; i < scheduler->count; i++) {
+        struct htu21_job *candidate = scheduler->jobs[i];
+
+        // Between two instances : a pending demotion takes effect
+        if (candidate->release_us > now_us)
+            htu21_scheduler_apply_demotion(candidate, now_us);
+        htu21_scheduler_skip_elapsed(candidate, now_us);
+        if (candidate->release_us > now_us) {
+            if (candidate->release_us < next_release_us)
+                next_release_us = candidate->release_us;
+        } else if (job == NULL || candidate->absolute_deadline_us < job->absolute_deadline_us) {
+            job = candidate;
+        }
+    }
+    if (job == NULL)
+        return htu21_scheduler_idle(scheduler, now_us, next_release_us);
+
+    // Not preemptible : idle rather than make an earlier deadline miss
+    cost = htu21_scheduler_cost(job);
+    for (i = 0; i < scheduler->count; i++) {
+        struct htu21_job *other = scheduler->jobs[i];
+
+        if (other->release_us > now_us && other->release_us < now_us + cost
+            && other->absolute_deadline_us < job->absolute_deadline_us
+            && now_us + cost + htu21_scheduler_cost(other) > other->absolute_deadline_us)
+            return htu21_scheduler_idle(scheduler, now_us, other->release_us);
+    }
+
+    status = htu21_dev_read_temperature_and_relative_humidity(job->device, &temperature, &humidity);
+    end_us = esp_timer_get_time();
+
+    job->completions++;
+    metrics = __atomic_load_n(&job->device->metrics, __ATOMIC_ACQUIRE);
+    if (metrics != NULL)
+        metrics->jobs_completed++;
+    if (end_us > job->absolute_deadline_us)
+        htu21_scheduler_count_miss(job, 1, (uint32_t) (end_us - job->absolute_deadline_us));
+
+    job->release_us += job->period_us;
+    job->absolute_deadline_us = job->release_us + job->deadline_us;
+
+    if (job->callback != NULL)
+        job->callback(job, status, temperature, humidity, job->arg);
+    htu21_scheduler_apply_demotion(job, end_us);
+
+    return 0;
+}
+
+/**
+ * \brief Scheduler task body : runs the jobs forever.
+ *
+ * \param[in] void* : htu21_scheduler*
+ */
+void htu21_scheduler_task(void *arg)
+{
+    struct htu21_scheduler *scheduler = (struct htu21_scheduler *) arg;
+
+    for (;;) {
+        // Rounded up, so that no job is polled before its release
+        htu21_wait_us(htu21_scheduler_run_once(scheduler, esp_timer_get_time()));
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
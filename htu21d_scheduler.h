@@ -0,0 +1,172 @@
+/**
+ * \file htu21d_scheduler.h
+ *
+ * \brief HTU21 earliest-deadline-first measurement scheduler header file
+ *
+ * Each job measures one device periodically. A job is released at the start
+ * of each period and has to complete within its relative deadline. Among the
+ * released jobs the scheduler runs the one with the earliest absolute
+ * deadline.
+ *
+ * A measurement cannot be preempted. Its cost is the conversion time of the
+ * device at its current resolution plus HTU21_SCHEDULER_TRANSFER_US, plus the
+ * wait its governor imposes before the trigger (see htu21d_governor.h). Before
+ * starting a job, the scheduler checks that every job released during that
+ * cost with an earlier deadline can still meet it. If one cannot, the
+ * scheduler idles until that release. Background jobs with long deadlines
+ * therefore only fill the gaps left by the critical ones.
+ *
+ * A job that completes after its deadline, or whose periods elapse without
+ * it running, counts as a deadline miss in the job and in the metrics of the
+ * device (see htu21d_metrics.h).
+ *
+ * When no job can run, the scheduler hands the idle time to an optional idle
+ * hook (e.g. htu21d_discovery.h), on the scheduler task.
+ *
+ * A job may be demoted : its period and deadline stretched by a factor, so
+ * that a failing device (see htu21d_health.h) keeps being watched without
+ * using the bus at full rate, and yields to the healthy ones.
+ *
+ */
+
+#ifndef HTU21_SCHEDULER_H_INCLUDED
+#define HTU21_SCHEDULER_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+#ifndef HTU21_SCHEDULER_MAX_JOBS
+#define HTU21_SCHEDULER_MAX_JOBS                            8
+#endif
+
+// I2C transfers of one measurement, added to the conversion time (us)
+#ifndef HTU21_SCHEDULER_TRANSFER_US
+#define HTU21_SCHEDULER_TRANSFER_US                            1000
+#endif
+
+// Longest period or deadline, held in us on 32 bits (about 71 min)
+#define HTU21_SCHEDULER_MAX_PERIOD_MS                        (UINT32_MAX / 1000)
+
+struct htu21_job;
+
+// Called by the scheduler task at the end of each run of the job
+typedef void (*htu21_job_callback)(struct htu21_job *, enum htu21_status, htu21_real_t, htu21_real_t, void *);
+
+struct htu21_job {
+    struct htu21_device *device;
+    uint32_t period_us;
+    uint32_t deadline_us;
+    // Period and deadline given to htu21_scheduler_add, before demotion
+    uint32_t nominal_period_us;
+    uint32_t nominal_deadline_us;
+    // Demotion factor, applied between two instances
+    uint32_t factor;
+    htu21_job_callback callback;
+    void *arg;
+    // Current release and absolute deadline (us)
+    int64_t release_us;
+    int64_t absolute_deadline_us;
+    // Statistics
+    uint32_t completions;
+    uint32_t misses;
+    uint32_t max_lateness_us;
+};
+
+// Called when no job can run for idle_us. Returns true when it used the bus.
+typedef bool (*htu21_scheduler_idle_hook)(void *arg, int64_t now_us, uint32_t idle_us);
+
+struct htu21_scheduler {
+    struct htu21_job *jobs[HTU21_SCHEDULER_MAX_JOBS];
+    uint32_t count;
+    htu21_scheduler_idle_hook idle_hook;
+    void *idle_arg;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a scheduler without jobs.
+ *
+ * \param[out] htu21_scheduler* : Scheduler to initialize
+ */
+void htu21_scheduler_init(struct htu21_scheduler *);
+
+/**
+ * \brief Adds a periodic job, first released at the given time.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_job* : Job, owned by the caller while scheduled
+ * \param[in] htu21_device* : Device measured by the job
+ * \param[in] uint32_t : Period (ms)
+ * \param[in] uint32_t : Relative deadline (ms), 0 for the period
+ * \param[in] int64_t : First release (us)
+ * \param[in] htu21_job_callback : Called after each run, may be NULL
+ * \param[in] void* : Argument of the callback
+ *
+ * \return bool : false when the scheduler is full, the period is 0, or the
+ *                period or the deadline is above HTU21_SCHEDULER_MAX_PERIOD_MS
+ */
+bool htu21_scheduler_add(struct htu21_scheduler *, struct htu21_job *, struct htu21_device *, uint32_t, uint32_t,
+                         int64_t, htu21_job_callback, void *);
+
+/**
+ * \brief Removes a job.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_job* : Job
+ */
+void htu21_scheduler_remove(struct htu21_scheduler *, struct htu21_job *);
+
+/**
+ * \brief Stretches the period and deadline of a job by a factor. A factor of
+ *        1 restores them. The scheduler applies it between two instances of
+ *        the job : an instance already released still runs, and the factor
+ *        counts from the release that follows it. From the scheduler task
+ *        (job callback or idle hook).
+ *
+ * \param[in] htu21_job* : Job
+ * \param[in] uint32_t : Factor, at least 1
+ */
+void htu21_scheduler_demote(struct htu21_job *, uint32_t);
+
+/**
+ * \brief Sets the hook run in the idle time of the scheduler. It may add and
+ *        remove jobs.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] htu21_scheduler_idle_hook : Hook, NULL for none
+ * \param[in] void* : Argument of the hook
+ */
+void htu21_scheduler_set_idle_hook(struct htu21_scheduler *, htu21_scheduler_idle_hook, void *);
+
+/**
+ * \brief Returns the bus utilization of the jobs, sum of cost / period,
+ *        the cost including the governor waits of a period too short for
+ *        the duty cycle limit. Above 1000 permille the deadlines cannot all
+ *        be met.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ *
+ * \return uint32_t - Utilization (permille).
+ */
+uint32_t htu21_scheduler_utilization(const struct htu21_scheduler *);
+
+/**
+ * \brief Runs at most one job.
+ *
+ * \param[in] htu21_scheduler* : Scheduler
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return uint32_t - Time until the scheduler needs to run again (us).
+ */
+uint32_t htu21_scheduler_run_once(struct htu21_scheduler *, int64_t);
+
+/**
+ * \brief Scheduler task body : runs the jobs forever.
+ *
+ * \param[in] void* : htu21_scheduler*
+ */
+void htu21_scheduler_task(void *);
+
+#endif /* HTU21_SCHEDULER_H_INCLUDED */
@@ -0,0 +1,129 @@
+/**
+ * \file htu21d_thermal.c
+ *
+ * \brief HTU21 self-heating compensation model source file
+ *
+ */
+
+#include <math.h>
+#include "htu21d_thermal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Integrates the model up to the given time with constant input.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : End of the segment (us)
+ * \param[in] bool : true if the device is converting during the segment
+ */
+static void htu21_thermal_advance(struct htu21_thermal_model *model, int64_t until_us, bool converting)
+{
+    float target = 0;
+
+    if (!model->started) {
+        model->updated_us = until_us;
+        model->started = true;
+        return;
+    }
+    if (until_us <= model->updated_us)
+        return;
+
+    if (converting)
+        target += model->self_heating;
+    if (model->heater == htu21_heater_on)
+        target += model->heater_rise;
+
+    model->offset = target + (model->offset - target)
+                             * expf(-(float) (until_us - model->updated_us) / model->time_constant_us);
+    model->updated_us = until_us;
+}
+
+/**
+ * \brief Initializes a thermal model.
+ *
+ * \param[out] htu21_thermal_model* : Model to initialize
+ * \param[in] float : Steady-state self-heating at 100 % duty cycle (degC)
+ * \param[in] float : Steady-state temperature rise with heater on (degC)
+ * \param[in] uint32_t : Time constant (ms)
+ */
+void htu21_thermal_init(struct htu21_thermal_model *model, float self_heating, float heater_rise,
+                        uint32_t time_constant_ms)
+{
+    model->self_heating = self_heating;
+    model->heater_rise = heater_rise;
+    model->time_constant_us = (float) (time_constant_ms ? time_constant_ms : 1) * 1000;
+    model->offset = 0;
+    model->updated_us = 0;
+    model->conversion_end_us = 0;
+    model->heater = htu21_heater_off;
+    model->started = false;
+}
+
+/**
+ * \brief Records a conversion issued to the device.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time the conversion was triggered (us)
+ * \param[in] uint32_t : Conversion time (us)
+ */
+void htu21_thermal_record_conversion(struct htu21_thermal_model *model, int64_t start_us, uint32_t duration_us)
+{
+    // Finish the previous conversion, cool down until this one starts, then heat
+    htu21_thermal_advance(model, model->conversion_end_us, true);
+    htu21_thermal_advance(model, start_us, false);
+    model->conversion_end_us = start_us + duration_us;
+}
+
+/**
+ * \brief Updates the heater state used by the model.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time of the change (us)
+ * \param[in] htu21_heater_status : New heater status
+ */
+void htu21_thermal_set_heater(struct htu21_thermal_model *model, int64_t now_us, enum htu21_heater_status heater)
+{
+    htu21_thermal_offset(model, now_us);
+    model->heater = heater;
+}
+
+/**
+ * \brief Returns the estimated self-heating offset.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return float - Die temperature above ambient (degC).
+ */
+float htu21_thermal_offset(struct htu21_thermal_model *model, int64_t now_us)
+{
+    if (now_us < model->conversion_end_us) {
+        htu21_thermal_advance(model, now_us, true);
+    } else {
+        htu21_thermal_advance(model, model->conversion_end_us, true);
+        htu21_thermal_advance(model, now_us, false);
+    }
+    return model->offset;
+}
+
+/**
+ * \brief Removes the estimated self-heating offset from a temperature.
+ *        Feed the result to htu21_compute_compensated_humidity.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time of the measurement (us)
+ * \param[in] float : Measured temperature (degC)
+ *
+ * \return float - Corrected temperature (degC).
+ */
+float htu21_thermal_correct_temperature(struct htu21_thermal_model *model, int64_t now_us, float temperature)
+{
+    return temperature - htu21_thermal_offset(model, now_us);
+}
+
+#ifdef __cplusplus
+}
+#endif
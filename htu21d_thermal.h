@@ -0,0 +1,99 @@
+/**
+ * \file htu21d_thermal.h
+ *
+ * \brief HTU21 self-heating compensation model header file
+ *
+ * First-order thermal model of the sensor die. Each conversion dissipates
+ * power and pushes the die temperature towards a steady-state offset, the
+ * on-chip heater adds its own offset, and the die relaxes towards ambient
+ * with a single time constant between conversions.
+ *
+ * The model is integrated exactly over the conversion and idle segments
+ * reported by the driver, so it follows the real duty cycle of the device
+ * rather than an average rate.
+ *
+ */
+
+#ifndef HTU21_THERMAL_H_INCLUDED
+#define HTU21_THERMAL_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "htu21d.h"
+
+// Default model parameters. These are starting points only : characterize
+// the mounting (PCB copper, enclosure, airflow) and adjust them.
+#define HTU21_THERMAL_DEFAULT_SELF_HEATING                    (float)(1.5)    // degC at 100 % duty cycle
+#define HTU21_THERMAL_DEFAULT_HEATER_RISE                    (float)(1.0)    // degC with heater on
+#define HTU21_THERMAL_DEFAULT_TIME_CONSTANT_MS                8000            // ms value
+
+struct htu21_thermal_model {
+    // Steady-state offset while converting continuously (degC)
+    float self_heating;
+    // Steady-state offset caused by the on-chip heater (degC)
+    float heater_rise;
+    // Die time constant (us)
+    float time_constant_us;
+    // Estimated die temperature offset (degC)
+    float offset;
+    // Time up to which the offset has been integrated (us)
+    int64_t updated_us;
+    // End of the last conversion (us)
+    int64_t conversion_end_us;
+    enum htu21_heater_status heater;
+    bool started;
+};
+
+// Functions
+
+/**
+ * \brief Initializes a thermal model.
+ *
+ * \param[out] htu21_thermal_model* : Model to initialize
+ * \param[in] float : Steady-state self-heating at 100 % duty cycle (degC)
+ * \param[in] float : Steady-state temperature rise with heater on (degC)
+ * \param[in] uint32_t : Time constant (ms)
+ */
+void htu21_thermal_init(struct htu21_thermal_model *, float, float, uint32_t);
+
+/**
+ * \brief Records a conversion issued to the device.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time the conversion was triggered (us)
+ * \param[in] uint32_t : Conversion time (us)
+ */
+void htu21_thermal_record_conversion(struct htu21_thermal_model *, int64_t, uint32_t);
+
+/**
+ * \brief Updates the heater state used by the model.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time of the change (us)
+ * \param[in] htu21_heater_status : New heater status
+ */
+void htu21_thermal_set_heater(struct htu21_thermal_model *, int64_t, enum htu21_heater_status);
+
+/**
+ * \brief Returns the estimated self-heating offset.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Current time (us)
+ *
+ * \return float - Die temperature above ambient (degC).
+ */
+float htu21_thermal_offset(struct htu21_thermal_model *, int64_t);
+
+/**
+ * \brief Removes the estimated self-heating offset from a temperature.
+ *        Feed the result to htu21_compute_compensated_humidity.
+ *
+ * \param[in] htu21_thermal_model* : Model
+ * \param[in] int64_t : Time of the measurement (us)
+ * \param[in] float : Measured temperature (degC)
+ *
+ * \return float - Corrected temperature (degC).
+ */
+float htu21_thermal_correct_temperature(struct htu21_thermal_model *, int64_t, float);
+
+#endif /* HTU21_THERMAL_H_INCLUDED */
@@ -0,0 +1,8 @@
+#
+# Unit tests of the HTU21 driver, built by the ESP-IDF unit-test-app :
+#
+#     make -C $IDF_PATH/tools/unit-test-app TEST_COMPONENTS=htu21d
+#
+# The LUT tests only run with the lookup tables enabled in ../component.mk.
+#
+COMPONENT_ADD_LDFLAGS = -Wl,--whole-archive -l$(COMPONENT_NAME) -Wl,--no-whole-archive
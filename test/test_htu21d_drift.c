@@ -0,0 +1,77 @@
+/**
+ * \file test_htu21d_drift.c
+ *
+ * \brief HTU21 long-term drift tracker unit tests
+ *
+ * A day of samples at a high rate sums past 32 bits : the aggregates stay
+ * exact, and so does the exposure time above the threshold.
+ *
+ */
+
+#include "unity.h"
+#include "htu21d.h"
+#include "htu21d_drift.h"
+
+#define HTU21_TEST_SERIAL                                    0x4854553231440001ULL
+// Start of a day, far enough from the epoch to be a real clock
+#define HTU21_TEST_DAY                                        20000
+// Samples per second, alternating low and high humidity, high last
+#define HTU21_TEST_RATE                                        8
+// Below a hundredth, above the precision of a float around 100
+#define HTU21_TEST_TOLERANCE                                0.001
+
+static double htu21_test_value(htu21_real_t value)
+{
+    return (double) value / HTU21_REAL_SCALE;
+}
+
+TEST_CASE("drift sums stay exact past 32 bits", "[htu21d][drift]")
+{
+    static struct htu21_drift_record record;
+    struct htu21_drift_summary summary;
+    uint32_t start = HTU21_TEST_DAY * HTU21_DRIFT_DAY_S;
+    uint32_t s, i;
+
+    htu21_drift_init(&record, HTU21_TEST_SERIAL);
+    for (s = 0; s < HTU21_DRIFT_DAY_S; s++) {
+        for (i = 0; i < HTU21_TEST_RATE; i++)
+            htu21_drift_update(&record, start + s, HTU21_REAL(85),
+                               (i % 2 == 0) ? HTU21_REAL(0.02) : HTU21_REAL(99.99));
+    }
+
+    // 691200 samples : 5.9e9 and 3.5e9 hundredths, beyond 32 bits
+    TEST_ASSERT_TRUE(htu21_drift_summarize(&record, 1, &summary));
+    TEST_ASSERT_EQUAL_UINT32(1, summary.days);
+    TEST_ASSERT_EQUAL_UINT32(HTU21_DRIFT_DAY_S * HTU21_TEST_RATE, summary.samples);
+    TEST_ASSERT_DOUBLE_WITHIN(HTU21_TEST_TOLERANCE, 85.00, htu21_test_value(summary.temperature_mean));
+    // 50.005 %RH, rounded half away from zero
+    TEST_ASSERT_DOUBLE_WITHIN(HTU21_TEST_TOLERANCE, 50.01, htu21_test_value(summary.humidity_mean));
+    TEST_ASSERT_DOUBLE_WITHIN(HTU21_TEST_TOLERANCE, 0.02, htu21_test_value(summary.humidity_min));
+    TEST_ASSERT_DOUBLE_WITHIN(HTU21_TEST_TOLERANCE, 99.99, htu21_test_value(summary.humidity_max));
+    // Each second ends high : every second after the first is exposure
+    TEST_ASSERT_EQUAL_UINT32(HTU21_DRIFT_DAY_S - 1, summary.high_humidity_s);
+    TEST_ASSERT_EQUAL_UINT64(HTU21_DRIFT_DAY_S - 1, record.high_humidity_total_s);
+
+    // The next day starts a new slot, the previous one is kept
+    htu21_drift_update(&record, start + HTU21_DRIFT_DAY_S, HTU21_REAL(20), HTU21_REAL(40));
+    TEST_ASSERT_TRUE(htu21_drift_summarize(&record, 1, &summary));
+    TEST_ASSERT_EQUAL_UINT32(1, summary.samples);
+    TEST_ASSERT_TRUE(htu21_drift_summarize(&record, HTU21_DRIFT_DAYS, &summary));
+    TEST_ASSERT_EQUAL_UINT32(2, summary.days);
+    TEST_ASSERT_EQUAL_UINT32(HTU21_DRIFT_DAY_S * HTU21_TEST_RATE + 1, summary.samples);
+    TEST_ASSERT_EQUAL_UINT32(HTU21_DRIFT_DAY_S, summary.high_humidity_s);
+}
+
+TEST_CASE("drift record reads back only when sealed for the sensor", "[htu21d][drift]")
+{
+    static struct htu21_drift_record record;
+
+    htu21_drift_init(&record, HTU21_TEST_SERIAL);
+    htu21_drift_update(&record, HTU21_TEST_DAY * HTU21_DRIFT_DAY_S, HTU21_REAL(20), HTU21_REAL(40));
+    htu21_drift_seal(&record);
+    TEST_ASSERT_TRUE(htu21_drift_check(&record, HTU21_TEST_SERIAL));
+    TEST_ASSERT_FALSE(htu21_drift_check(&record, HTU21_TEST_SERIAL + 1));
+
+    record.ring[0].samples++;
+    TEST_ASSERT_FALSE(htu21_drift_check(&record, HTU21_TEST_SERIAL));
+}
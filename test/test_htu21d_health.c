@@ -0,0 +1,94 @@
+/**
+ * \file test_htu21d_health.c
+ *
+ * \brief HTU21 sensor health monitor unit tests
+ *
+ * The humidity rails are flagged at the ADC limits of every resolution and
+ * not one code inside them, the flatline count follows the resolution, and
+ * failed transfers in the driver counters are flagged.
+ *
+ */
+
+#include "unity.h"
+#include "htu21d.h"
+#include "htu21d_health.h"
+
+// Shift clearing the unused bits of a humidity code, per resolution
+static const unsigned htu21_test_humidity_shift[] = {
+    [htu21_resolution_t_14b_rh_12b] = 4,
+    [htu21_resolution_t_12b_rh_8b]  = 8,
+    [htu21_resolution_t_13b_rh_10b] = 6,
+    [htu21_resolution_t_11b_rh_11b] = 5,
+};
+
+static uint32_t htu21_test_humidity_conditions(uint16_t adc)
+{
+    struct htu21_health health;
+
+    htu21_health_init(&health, 4, NULL, NULL);
+    htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), htu21_convert_humidity(adc), NULL);
+
+    return health.conditions;
+}
+
+TEST_CASE("health flags the humidity rails of the ADC", "[htu21d][health]")
+{
+    unsigned res;
+
+    // Code 0 is -6 %RH, the next 8-bit code -5.51 %RH
+    TEST_ASSERT_EQUAL_UINT32(HTU21_HEALTH_OUT_OF_RANGE, htu21_test_humidity_conditions(0x0000));
+    TEST_ASSERT_EQUAL_UINT32(0, htu21_test_humidity_conditions(0x0100));
+
+    // Top code of each resolution, from 118.51 %RH at 8 bits to 118.97 %RH at 12 bits
+    for (res = 0; res < sizeof(htu21_test_humidity_shift) / sizeof(htu21_test_humidity_shift[0]); res++) {
+        unsigned shift = htu21_test_humidity_shift[res];
+
+        TEST_ASSERT_EQUAL_UINT32(HTU21_HEALTH_OUT_OF_RANGE,
+                                 htu21_test_humidity_conditions((uint16_t) (0xFFFF >> shift << shift)));
+    }
+
+    // One 8-bit code below the top, 118.02 %RH, and valid readings past 100 %RH
+    TEST_ASSERT_EQUAL_UINT32(0, htu21_test_humidity_conditions(0xFE00));
+    TEST_ASSERT_EQUAL_UINT32(0, htu21_test_humidity_conditions(0xE000));
+}
+
+TEST_CASE("health flatline count follows the resolution", "[htu21d][health]")
+{
+    struct htu21_health health;
+    uint32_t i;
+
+    htu21_health_init(&health, 4, NULL, NULL);
+    htu21_health_set_resolution(&health, htu21_resolution_t_12b_rh_8b);
+    for (i = 1; i < 16 * HTU21_HEALTH_FLATLINE_SAMPLES; i++)
+        TEST_ASSERT_TRUE(htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), HTU21_REAL(40), NULL));
+    TEST_ASSERT_FALSE(htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), HTU21_REAL(40), NULL));
+    TEST_ASSERT_EQUAL_UINT32(HTU21_HEALTH_FLATLINE, health.conditions);
+
+    htu21_health_init(&health, 4, NULL, NULL);
+    htu21_health_set_resolution(&health, htu21_resolution_t_14b_rh_12b);
+    for (i = 1; i < HTU21_HEALTH_FLATLINE_SAMPLES; i++)
+        htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), HTU21_REAL(40), NULL);
+    TEST_ASSERT_FALSE(htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), HTU21_REAL(40), NULL));
+}
+
+TEST_CASE("health flags failed transfers in the driver counters", "[htu21d][health]")
+{
+    struct htu21_health health;
+    struct htu21_metrics metrics;
+    uint32_t i;
+
+    htu21_metrics_init(&metrics);
+    htu21_health_init(&health, 4, NULL, NULL);
+
+    // Transfers that succeeded on a retry : the samples themselves are fine
+    for (i = 0; i < HTU21_HEALTH_BUS_ERRORS - 1; i++) {
+        metrics.transfer_errors++;
+        TEST_ASSERT_TRUE(htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25),
+                                             HTU21_REAL(40 + i), &metrics));
+    }
+    metrics.bus_recovery_failures++;
+    TEST_ASSERT_FALSE(htu21_health_update(&health, htu21_status_ok, HTU21_REAL(25), HTU21_REAL(50),
+                                          &metrics));
+    TEST_ASSERT_EQUAL_UINT32(HTU21_HEALTH_BUS_ERRORS_SEEN, health.conditions);
+    TEST_ASSERT_EQUAL_UINT32(1, health.demotions);
+}
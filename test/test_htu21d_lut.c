@@ -0,0 +1,80 @@
+/**
+ * \file test_htu21d_lut.c
+ *
+ * \brief HTU21 conversion lookup tables unit tests
+ *
+ * Every ADC code converted through a table gives the same value as the
+ * run-time conversion of the code with its unused bits cleared.
+ *
+ */
+
+#include "unity.h"
+#include "htu21d.h"
+#include "htu21d_lut.h"
+
+#define HTU21_TEST_CODES                                    (1UL << 16)
+
+static void htu21_test_lut_temperature(enum htu21_resolution res, unsigned shift)
+{
+    htu21_real_t value;
+    uint32_t adc;
+
+    for (adc = 0; adc < HTU21_TEST_CODES; adc++) {
+        TEST_ASSERT_TRUE(htu21_lut_temperature(res, (uint16_t) adc, &value));
+        if (value != htu21_convert_temperature((uint16_t) (adc >> shift << shift)))
+            TEST_FAIL_MESSAGE("temperature LUT differs from the run-time conversion");
+    }
+}
+
+static void htu21_test_lut_humidity(enum htu21_resolution res, unsigned shift)
+{
+    htu21_real_t value;
+    uint32_t adc;
+
+    for (adc = 0; adc < HTU21_TEST_CODES; adc++) {
+        TEST_ASSERT_TRUE(htu21_lut_humidity(res, (uint16_t) adc, &value));
+        if (value != htu21_convert_humidity((uint16_t) (adc >> shift << shift)))
+            TEST_FAIL_MESSAGE("humidity LUT differs from the run-time conversion");
+    }
+}
+
+TEST_CASE("run-time conversion ignores the status bits", "[htu21d][lut]")
+{
+    uint32_t adc;
+
+    for (adc = 0; adc < HTU21_TEST_CODES; adc++) {
+        uint16_t code = (uint16_t) (adc & ~(uint32_t) HTU21_ADC_STATUS_MASK);
+
+        if (htu21_convert_temperature((uint16_t) adc) != htu21_convert_temperature(code)
+            || htu21_convert_humidity((uint16_t) adc) != htu21_convert_humidity(code))
+            TEST_FAIL_MESSAGE("status bits change the conversion");
+    }
+}
+
+TEST_CASE("LUT matches the run-time conversion, T 12 bits RH 8 bits", "[htu21d][lut]")
+{
+#ifdef HTU21_LUT_T_12B_RH_8B
+    htu21_test_lut_humidity(htu21_resolution_t_12b_rh_8b, HTU21_LUT_SHIFT_8B);
+#else
+    TEST_IGNORE_MESSAGE("HTU21_LUT_T_12B_RH_8B not enabled");
+#endif
+}
+
+TEST_CASE("LUT matches the run-time conversion, T 13 bits RH 10 bits", "[htu21d][lut]")
+{
+#ifdef HTU21_LUT_T_13B_RH_10B
+    htu21_test_lut_humidity(htu21_resolution_t_13b_rh_10b, HTU21_LUT_SHIFT_10B);
+#else
+    TEST_IGNORE_MESSAGE("HTU21_LUT_T_13B_RH_10B not enabled");
+#endif
+}
+
+TEST_CASE("LUT matches the run-time conversion, T 11 bits RH 11 bits", "[htu21d][lut]")
+{
+#ifdef HTU21_LUT_T_11B_RH_11B
+    htu21_test_lut_temperature(htu21_resolution_t_11b_rh_11b, HTU21_LUT_SHIFT_11B);
+    htu21_test_lut_humidity(htu21_resolution_t_11b_rh_11b, HTU21_LUT_SHIFT_11B);
+#else
+    TEST_IGNORE_MESSAGE("HTU21_LUT_T_11B_RH_11B not enabled");
+#endif
+}
@@ -0,0 +1,125 @@
+/**
+ * \file test_htu21d_numeric.c
+ *
+ * \brief HTU21 numeric precision policy unit tests
+ *
+ * Error bounds of the conversions and of the dew point against an exact
+ * double evaluation, for the policy the component is built with : run the
+ * tests once per HTU21_NUMERIC_POLICY to cover the matrix. The bounds are
+ * the ones documented in htu21d_numeric.h.
+ *
+ */
+
+#include <math.h>
+#include "unity.h"
+#include "htu21d.h"
+
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+#define HTU21_TEST_TEMPERATURE_BOUND                        0.005
+#define HTU21_TEST_HUMIDITY_BOUND                            0.005
+#define HTU21_TEST_DEW_POINT_BOUND                            0.0051
+#elif HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FLOAT
+#define HTU21_TEST_TEMPERATURE_BOUND                        0.00002
+#define HTU21_TEST_HUMIDITY_BOUND                            0.00001
+#define HTU21_TEST_DEW_POINT_BOUND                            0.0001
+#else
+#define HTU21_TEST_TEMPERATURE_BOUND                        1e-12
+#define HTU21_TEST_HUMIDITY_BOUND                            1e-12
+#define HTU21_TEST_DEW_POINT_BOUND                            1e-9
+#endif
+
+// Rounding of the fixed-point results to hundredths, on top of the bound
+#define HTU21_TEST_MARGIN                                    1e-9
+
+static double htu21_test_value(htu21_real_t value)
+{
+    return (double) value / HTU21_REAL_SCALE;
+}
+
+static double htu21_test_dew_point(double temperature, double humidity)
+{
+    double partial_pressure = pow(10, 8.1332 - 1762.39 / (temperature + 235.66));
+
+    return -1762.39 / (log10(humidity * partial_pressure / 100) - 8.1332) - 235.66;
+}
+
+TEST_CASE("temperature conversion error bound", "[htu21d][numeric]")
+{
+    double max_error = 0;
+    uint32_t adc;
+
+    for (adc = 0; adc <= 0xFFFF; adc++) {
+        double exact = -46.85 + 175.72 * (adc & ~(uint32_t) HTU21_ADC_STATUS_MASK) / 65536;
+        double error = fabs(htu21_test_value(htu21_convert_temperature((uint16_t) adc)) - exact);
+
+        if (error > max_error)
+            max_error = error;
+    }
+    TEST_ASSERT_TRUE(max_error <= HTU21_TEST_TEMPERATURE_BOUND + HTU21_TEST_MARGIN);
+}
+
+TEST_CASE("humidity conversion error bound", "[htu21d][numeric]")
+{
+    double max_error = 0;
+    uint32_t adc;
+
+    for (adc = 0; adc <= 0xFFFF; adc++) {
+        double exact = -6 + 125.0 * (adc & ~(uint32_t) HTU21_ADC_STATUS_MASK) / 65536;
+        double error = fabs(htu21_test_value(htu21_convert_humidity((uint16_t) adc)) - exact);
+
+        if (error > max_error)
+            max_error = error;
+    }
+    TEST_ASSERT_TRUE(max_error <= HTU21_TEST_HUMIDITY_BOUND + HTU21_TEST_MARGIN);
+}
+
+TEST_CASE("dew point error bound", "[htu21d][numeric]")
+{
+    double max_error = 0, max_fast_error = 0;
+    int t, h;
+
+    // 0.5 degC and 0.5 %RH steps, exactly representable in every policy
+    for (t = -80; t <= 250; t++) {
+        for (h = 2; h <= 200; h++) {
+            htu21_real_t temperature = HTU21_REAL_MUL(HTU21_REAL(0.5), HTU21_REAL(t));
+            htu21_real_t humidity = HTU21_REAL_MUL(HTU21_REAL(0.5), HTU21_REAL(h));
+            double exact = htu21_test_dew_point(t / 2.0, h / 2.0);
+            double error = fabs(htu21_test_value(htu21_compute_dew_point(temperature, humidity)) - exact);
+            double fast_error = fabs(htu21_test_value(htu21_compute_dew_point_fast(temperature, humidity)) - exact);
+
+            if (error > max_error)
+                max_error = error;
+            if (fast_error > max_fast_error)
+                max_fast_error = fast_error;
+        }
+    }
+    TEST_ASSERT_TRUE(max_error <= HTU21_TEST_DEW_POINT_BOUND + HTU21_TEST_MARGIN);
+    TEST_ASSERT_TRUE(max_fast_error <= HTU21_TEST_DEW_POINT_BOUND + HTU21_TEST_MARGIN);
+}
+
+TEST_CASE("fixed-point conversions are integer", "[htu21d][numeric]")
+{
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+    // Integer type : a fraction of a hundredth is not representable
+    TEST_ASSERT_TRUE((htu21_real_t) 0.5 == 0);
+    TEST_ASSERT_EQUAL_INT32(-4685, htu21_convert_temperature(0));
+    TEST_ASSERT_EQUAL_INT32(1905, htu21_convert_temperature(0x6000));
+    TEST_ASSERT_EQUAL_INT32(11899, htu21_convert_humidity(0xFFFF));
+    TEST_ASSERT_EQUAL_INT32(5000 - 375, htu21_compute_compensated_humidity(HTU21_REAL(0), HTU21_REAL(50)));
+#else
+    TEST_IGNORE_MESSAGE("HTU21_NUMERIC_FIXED not selected");
+#endif
+}
+
+TEST_CASE("fixed-point product rounds and does not overflow", "[htu21d][numeric]")
+{
+#if HTU21_NUMERIC_POLICY == HTU21_NUMERIC_FIXED
+    // 0.15 * 0.5 = 0.075 : rounded to the nearest hundredth, half away from zero
+    TEST_ASSERT_EQUAL_INT32(8, HTU21_REAL_MUL(HTU21_REAL(0.15), HTU21_REAL(0.5)));
+    TEST_ASSERT_EQUAL_INT32(-8, HTU21_REAL_MUL(HTU21_REAL(-0.15), HTU21_REAL(0.5)));
+    // 1000 * 1000 : the intermediate 10^10 does not fit in 32 bits
+    TEST_ASSERT_EQUAL_INT32(100000000, HTU21_REAL_MUL(HTU21_REAL(1000), HTU21_REAL(1000)));
+#else
+    TEST_IGNORE_MESSAGE("HTU21_NUMERIC_FIXED not selected");
+#endif
+}
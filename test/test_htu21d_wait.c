@@ -0,0 +1,58 @@
+/**
+ * \file test_htu21d_wait.c
+ *
+ * \brief HTU21 wait helper unit tests
+ *
+ * htu21_wait_us never returns before the requested time, whatever the phase
+ * of the tick it starts in, and waits at most the time rounded up to whole
+ * ticks plus one tick. A wait of 0 returns at once.
+ *
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "rom/ets_sys.h"
+#include "unity.h"
+#include "htu21d.h"
+
+#define HTU21_TEST_TICK_US                                    (portTICK_PERIOD_MS * 1000)
+// Scheduling latency allowed on top of the longest wait
+#define HTU21_TEST_SLACK_US                                    HTU21_TEST_TICK_US
+
+static const uint32_t htu21_test_waits_us[] = {
+    1, 999, 1000, 1001, HTU21_TEST_TICK_US - 1, HTU21_TEST_TICK_US, HTU21_TEST_TICK_US + 1,
+    2 * HTU21_TEST_TICK_US + HTU21_TEST_TICK_US / 2, 50000,
+};
+
+TEST_CASE("wait never ends early and rounds up to whole ticks", "[htu21d][wait]")
+{
+    unsigned i, phase;
+
+    for (i = 0; i < sizeof(htu21_test_waits_us) / sizeof(htu21_test_waits_us[0]); i++) {
+        uint32_t us = htu21_test_waits_us[i];
+        uint32_t ticks = ((us + 999) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1;
+
+        // Start at several points of a tick
+        for (phase = 0; phase < 4; phase++) {
+            int64_t start, elapsed;
+
+            vTaskDelay(1);
+            ets_delay_us(phase * HTU21_TEST_TICK_US / 4);
+            start = esp_timer_get_time();
+            htu21_wait_us(us);
+            elapsed = esp_timer_get_time() - start;
+
+            TEST_ASSERT_TRUE(elapsed >= us);
+            TEST_ASSERT_TRUE(elapsed <= (int64_t) ticks * HTU21_TEST_TICK_US + HTU21_TEST_SLACK_US);
+        }
+    }
+}
+
+TEST_CASE("wait of 0 returns at once", "[htu21d][wait]")
+{
+    int64_t start = esp_timer_get_time();
+
+    htu21_wait_us(0);
+    TEST_ASSERT_TRUE(esp_timer_get_time() - start < HTU21_TEST_TICK_US);
+}